@@ -0,0 +1,66 @@
+// Copyright (C) 2020 Conor Williams
+
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include "generate.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <ostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+void write_synthetic(Synthetic const& opt, std::ostream& out) {
+    if (opt.choices == 0 || opt.priority_weights.empty()) {
+        throw std::invalid_argument("Synthetic ballot needs choices and priorities");
+    }
+
+    std::size_t const m = std::max<std::size_t>(1, std::lround(opt.people * opt.rooms_per_person));
+
+    // Rooms are named by popularity, hostels are spread evenly through the popularity ranking
+    std::vector<std::string> names;
+    std::vector<double> weights;
+
+    std::size_t hostels = 0;
+
+    for (std::size_t r = 0; r < m; r++) {
+        bool hostel = std::floor((r + 1) * opt.hostel_fraction) > hostels;
+        hostels += hostel;
+        names.push_back((hostel ? synthetic_hostel : "R") + std::to_string(r));
+        weights.push_back(1 / std::pow(r + 1, opt.skew));
+    }
+
+    std::mt19937_64 gen(opt.seed);
+
+    std::discrete_distribution<std::size_t> room(weights.begin(), weights.end());
+    std::discrete_distribution<std::size_t> priority(opt.priority_weights.begin(),
+                                                     opt.priority_weights.end());
+
+    std::vector<std::size_t> pref;
+
+    for (std::size_t i = 0; i < opt.people; i++) {
+        out << "Person" << i << ",p" << i << "@cam.ac.uk," << priority(gen) + 1;
+
+        pref.clear();
+
+        // Rejection sample distinct choices, bounded in case of few or very skewed rooms
+        for (std::size_t tries = 0; pref.size() < opt.choices; tries++) {
+            std::size_t r = room(gen);
+
+            if (tries > 16 * opt.choices || std::find(pref.begin(), pref.end(), r) == pref.end()) {
+                pref.push_back(r);
+            }
+        }
+
+        for (std::size_t r : pref) {
+            out << ',' << names[r];
+        }
+
+        out << '\n';
+    }
+}
@@ -0,0 +1,33 @@
+// Copyright (C) 2020 Conor Williams
+
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+// Prefix of the hostel rooms in a synthetic ballot
+inline constexpr char const* synthetic_hostel = "H";
+
+/*
+ *  Parameters of a synthetic ballot. Room popularity follows a Zipf law (the r'th most popular room
+ *  is chosen with weight 1 / r^skew) and each person's priority is drawn with the given relative
+ *  weights for priorities 1, 2, .... A person's choices are distinct unless they run out of rooms.
+ */
+struct Synthetic {
+    std::size_t people = 100;
+    std::size_t choices = 5;
+    double rooms_per_person = 1.2;
+    double skew = 1.0;
+    std::vector<double> priority_weights{1, 2, 2, 1};
+    double hostel_fraction = 0.1;
+    std::uint64_t seed = 0;
+};
+
+// Write a ballot csv (name, crsid, priority, choice 1, ..., choice n) in the format of parse_people
+void write_synthetic(Synthetic const&, std::ostream&);
@@ -0,0 +1,339 @@
+// Copyright (C) 2020 Conor Williams
+
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "ballot.hpp"
+#include "certificate.hpp"
+#include "cohort.hpp"
+#include "cost.hpp"
+#include "generate.hpp"
+#include "profile.hpp"
+#include "secrets.hpp"
+#include "simd.hpp"
+#include "solve.hpp"
+#include "structopt/app.hpp"
+
+struct Bench {
+    // Number of people in each benchmarked ballot
+    std::optional<std::vector<std::size_t>> sizes =
+        std::vector<std::size_t>{100, 1000, 10000, 100000};
+
+    std::optional<std::size_t> choices = 5;               // Choices per person
+    std::optional<double> rooms_per_person = 1.2;         // Number of rooms / number of people
+    std::optional<double> skew = 1.0;                     // Zipf exponent of room popularity
+    std::optional<std::vector<double>> priority_weights;  // Relative weights of priority 1, 2...
+    std::optional<double> hostel_fraction = 0.1;          // Fraction of rooms that are hostels
+    std::optional<std::uint64_t> seed = 0;                // Generator seed
+    std::optional<std::vector<Solver>> solvers;           // Default all of them
+    std::optional<std::size_t> threads = 1;               // Zero for all cores
+    std::optional<std::size_t> max_dense = 20000;         // Largest dense matrix dimension
+    std::optional<bool> integer = false;                  // Fixed-point costs
+    std::optional<std::string> emit;  // Write the ballot of the first size here and exit
+    std::optional<bool> check = false;  // Compare jv to lapjv, with and without AVX2, and exit
+};
+
+STRUCTOPT(Bench,
+          sizes,
+          choices,
+          rooms_per_person,
+          skew,
+          priority_weights,
+          hostel_fraction,
+          seed,
+          solvers,
+          threads,
+          max_dense,
+          integer,
+          emit,
+          check);
+
+namespace {  // Like static
+
+Synthetic synthetic(Bench const& args, std::size_t n) {
+    Synthetic opt;
+
+    opt.people = n;
+    opt.choices = *args.choices;
+    opt.rooms_per_person = *args.rooms_per_person;
+    opt.skew = *args.skew;
+    opt.hostel_fraction = *args.hostel_fraction;
+    opt.seed = *args.seed;
+
+    if (args.priority_weights) {
+        opt.priority_weights = *args.priority_weights;
+    }
+
+    return opt;
+}
+
+void print_header() {
+    std::cout << std::setw(8) << "people" << std::setw(8) << "solver";
+
+    for (char const* phase :
+         {"parse", "anonymise", "intern", "table", "matrix", "solve", "check"}) {
+        std::cout << std::setw(11) << phase;
+    }
+
+    std::cout << std::setw(11) << "peak MiB" << '\n';
+}
+
+// Time each phase of running then verifying a ballot of n people
+void bench(Bench const& args, std::size_t n, Solver solver) {
+    auto fname = std::filesystem::temp_directory_path() / ("ballot_bench_" + std::to_string(n));
+
+    {
+        std::ofstream file(fname);
+        write_synthetic(synthetic(args, n), file);
+    }
+
+    std::optional<PeopleCsv> csv;
+    std::vector<std::size_t> rows;
+    std::vector<Person> people;
+    std::optional<Cohort> cohort;
+    std::optional<CostTable> table;
+    Solution solution;
+
+    std::optional<std::vector<std::string>> hostels = std::vector<std::string>{synthetic_hostel};
+
+    std::vector<double> t;
+
+    // Collects the matrix timer of the solve, resets the peak memory
+    Profile profile;
+
+    t.push_back(seconds([&] { csv.emplace(read_people(fname.string())); }));
+
+    // As run, the people are built once in anonymised order
+    t.push_back(seconds([&] {
+        rows = shuffled_order(*csv, 0);
+        people = parse_people(*csv, rows);
+
+        for (auto&& p : people) {
+            anonymise(*p);
+        }
+    }));
+
+    t.push_back(seconds([&] {
+        std::vector head = rows;
+
+        std::stable_sort(head.begin(), head.end(), [&](std::size_t a, std::size_t b) {
+            return csv->priority(a) < csv->priority(b);
+        });
+        cohort = intern(*csv, head, hostels);
+    }));
+
+    std::size_t slots = 0;
+
+    for (std::size_t c : cohort->capacity) {
+        slots += c;
+    }
+
+    if (solver != Solver::sparse && solver != Solver::auction && n + slots > *args.max_dense) {
+        std::cout << std::setw(8) << n << std::setw(8) << solver_name(solver) << "   skipped, ";
+        std::cout << n + slots << " > --max-dense\n";
+        std::filesystem::remove(fname);
+        return;
+    }
+
+    t.push_back(seconds([&] {
+        table.emplace(*cohort);
+
+        if (*args.integer) {
+            table = table->quantised();
+        }
+    }));
+
+    double const solve_time = seconds([&] {
+        solution = solve(*cohort, *table, {solver, *args.threads, false, false, &profile});
+    });
+
+    // Building the dense cost matrix, zero for the sparse solvers
+    double const matrix = profile.timer("matrix");
+
+    t.push_back(matrix);
+    t.push_back(solve_time - matrix);
+
+    t.push_back(seconds([&] { check_certificate(*cohort, *table, solution); }));
+
+    std::cout << std::setw(8) << n << std::setw(8) << solver_name(solver) << std::fixed;
+
+    for (double s : t) {
+        std::cout << std::setw(11) << std::setprecision(4) << s;
+    }
+
+    std::cout << std::setw(11) << std::setprecision(1) << peak_rss() << '\n';
+
+    std::filesystem::remove(fname);
+}
+
+// Solve the ballot of each size with lapjv then with jv, with and without AVX2, for both double and
+// integer costs. The allocations and potentials must be identical, returns the number that differ.
+std::size_t check(Bench const& args) {
+    std::optional<std::vector<std::string>> hostels = std::vector<std::string>{synthetic_hostel};
+
+    std::size_t differ = 0;
+
+    for (std::size_t n : *args.sizes) {
+        auto fname = std::filesystem::temp_directory_path() / ("ballot_check_" + std::to_string(n));
+
+        {
+            std::ofstream file(fname);
+            write_synthetic(synthetic(args, n), file);
+        }
+
+        PeopleCsv const csv = read_people(fname.string());
+
+        std::vector<std::size_t> rows(csv.size());
+
+        std::iota(rows.begin(), rows.end(), 0);
+
+        Cohort const cohort = intern(csv, rows, hostels);
+
+        std::filesystem::remove(fname);
+
+        std::size_t slots = 0;
+
+        for (std::size_t c : cohort.capacity) {
+            slots += c;
+        }
+
+        if (n + slots > *args.max_dense) {
+            std::cout << std::setw(8) << n << "   skipped, " << n + slots << " > --max-dense\n";
+            continue;
+        }
+
+        for (bool integer : {false, true}) {
+            CostTable const table = integer ? CostTable{cohort}.quantised() : CostTable{cohort};
+
+            Solution const lapjv = solve(cohort, table, {Solver::lapjv});
+
+            for (bool avx2 : {true, false}) {
+                simd::disable_avx2(!avx2);
+
+                std::cout << std::setw(8) << n << std::setw(9) << (integer ? "integer" : "double");
+                std::cout << std::setw(9) << (avx2 ? "avx2" : "scalar");
+
+                if (avx2 && !simd::avx2()) {
+                    std::cout << "   unsupported\n";
+                    continue;
+                }
+
+                Solution const jv = solve(cohort, table, {Solver::jv, *args.threads});
+
+                bool const same
+                    = jv.allocation == lapjv.allocation && jv.u == lapjv.u && jv.v == lapjv.v;
+
+                std::cout << (same ? "   identical\n" : "   DIFFERENT\n");
+
+                differ += !same;
+            }
+
+            simd::disable_avx2(false);
+        }
+    }
+
+    return differ;
+}
+
+// Run bench in a child process, so the peak memory is that of this case alone
+void bench_isolated(Bench const& args, std::size_t n, Solver solver) {
+    std::cout.flush();
+
+    pid_t const pid = ::fork();
+
+    if (pid < 0) {
+        throw std::runtime_error("Could not fork");
+    }
+
+    if (pid == 0) {
+        int code = EXIT_SUCCESS;
+
+        try {
+            bench(args, n, solver);
+        } catch (std::exception const& e) {
+            std::cout << std::setw(8) << n << std::setw(8) << solver_name(solver) << "   failed, ";
+            std::cout << e.what() << '\n';
+            code = EXIT_FAILURE;
+        }
+
+        std::cout.flush();
+        std::_Exit(code);
+    }
+
+    int status = 0;
+
+    if (::waitpid(pid, &status, 0) < 0 || !WIFEXITED(status)) {
+        std::cout << std::setw(8) << n << std::setw(8) << solver_name(solver) << "   crashed\n";
+    }
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    Bench args;
+
+    try {
+        args = structopt::app("ballot_bench").parse<Bench>(argc, argv);
+    } catch (structopt::exception& e) {
+        std::cout << e.what() << "\n";
+        std::cout << e.help();
+        return 1;
+    }
+
+    if (args.sizes->empty()) {
+        return 0;
+    }
+
+    if (args.emit) {
+        std::ofstream file(*args.emit);
+        write_synthetic(synthetic(args, args.sizes->front()), file);
+        return 0;
+    }
+
+    if (*args.check) {
+        std::cout << "-- Comparing the allocations and potentials of jv to lapjv\n\n";
+
+        std::size_t const differ = check(args);
+
+        std::cout << "\n-- " << differ << " cases differ\n";
+
+        return differ == 0 ? 0 : 1;
+    }
+
+    std::vector<Solver> solvers = args.solvers.value_or(std::vector<Solver>{
+        Solver::lapjv, Solver::jv, Solver::dense, Solver::sparse, Solver::auction});
+
+    std::sort(args.sizes->begin(), args.sizes->end());
+
+    std::cout << "-- Times in seconds, the solve excludes building the dense cost matrix\n";
+    std::cout << "-- Each case runs in its own process, the peak memory is its own\n\n";
+
+    print_header();
+
+    for (std::size_t n : *args.sizes) {
+        for (Solver solver : solvers) {
+            bench_isolated(args, n, solver);
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,252 @@
+// Copyright (C) 2020 Conor Williams
+
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <algorithm>
+#include <barrier>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#include "parallel.hpp"
+#include "sparse.hpp"
+
+/*
+ *  Bertsekas' auction algorithm with epsilon scaling for the transportation problem of a SparseCost
+ *  with integer costs. Column j is split into capacity[j] slots, each with its own price, the kick
+ *  sink has unlimited capacity and price zero. Rounds are Jacobi: every unassigned row bids from
+ *  the prices at the start of the round, for the slot of lowest cost plus price (ties to the
+ *  earlier edge, then kick) raised by its margin over the next best plus epsilon. The bids are
+ *  computed on up to "threads" threads then each slot goes to its highest bid, ties to the lowest
+ *  row, hence the result does not depend on the number of threads.
+ *
+ *  Costs are multiplied by scale() = rows() + 1 so that the final epsilon of one leaves every row
+ *  within 1 / scale() units of complementary slackness, i.e. short of the optimum by less than one
+ *  unit in total. That holds once slots left free with a positive price (possible after the first
+ *  phase) are repriced to zero, which is left to SparseAssignment::warm_start.
+ */
+template <typename T = std::int64_t> class Auction {
+    static_assert(std::is_integral_v<T> && std::is_signed_v<T>);
+
+  public:
+    static constexpr std::uint32_t kicked = SparseAssignment<T>::kicked;
+    static constexpr std::uint32_t unassigned = SparseAssignment<T>::unassigned;
+
+    Auction(SparseCost<T> const &c, std::size_t threads = 1)
+        : m_c(c),
+          m_threads(threads),
+          m_scale(c.rows() + 1),
+          m_rowsol(c.rows(), unassigned),
+          m_slot_start(c.cols + 1, 0) {
+        if (!c.capacity.empty() && c.capacity.size() != c.cols) {
+            throw std::invalid_argument("Need a capacity for every column");
+        }
+
+        for (std::size_t j = 0; j < c.cols; j++) {
+            m_slot_start[j + 1] = m_slot_start[j] + (c.capacity.empty() ? 1 : c.capacity[j]);
+        }
+
+        m_price.assign(m_slot_start.back(), 0);
+        m_owner.assign(m_slot_start.back(), unassigned);
+        m_best.assign(m_slot_start.back(), none);
+    }
+
+    // Assign every row, the starting epsilon is 1/64 of the largest scaled kick cost
+    void solve() {
+        if (m_c.rows() == 0) {
+            return;
+        }
+
+        T eps = 1;
+
+        for (T k : m_c.kick) {
+            eps = std::max(eps, k * m_scale / 64);
+        }
+
+        for (;; eps = std::max<T>(1, eps / factor)) {
+            phase(eps);
+
+            if (eps == 1) {
+                break;
+            }
+        }
+    }
+
+    // Column assigned to row i or Auction::kicked
+    [[nodiscard]] std::uint32_t rowsol(std::size_t i) const {
+        return m_rowsol[i] == kicked ? kicked : column(m_rowsol[i]);
+    }
+
+    // Lowest price of the slots of column j (zero if it has none), in units of cost * scale()
+    [[nodiscard]] T price(std::size_t j) const {
+        auto first = m_price.begin() + m_slot_start[j];
+        auto last = m_price.begin() + m_slot_start[j + 1];
+        return first == last ? 0 : *std::min_element(first, last);
+    }
+
+    [[nodiscard]] T scale() const { return m_scale; }
+
+    // Number of epsilon scaling phases so far
+    [[nodiscard]] std::size_t phases() const { return m_phases; }
+
+    // Number of bidding rounds, over all phases, so far
+    [[nodiscard]] std::size_t rounds() const { return m_rounds; }
+
+    // Number of bids, over all rounds, so far
+    [[nodiscard]] std::size_t bids() const { return m_bids; }
+
+  private:
+    static constexpr T factor = 10;  // Epsilon reduction per phase
+    static constexpr std::size_t none = std::numeric_limits<std::size_t>::max();
+
+    struct Bid {
+        std::uint32_t slot;  // Or kicked
+        T price;
+    };
+
+    SparseCost<T> const &m_c;
+    std::size_t m_threads;
+    T m_scale;
+
+    std::vector<std::uint32_t> m_rowsol;  // Slot of each row, kicked or unassigned
+
+    // Slots of column j are [m_slot_start[j], m_slot_start[j + 1])
+    std::vector<std::uint32_t> m_slot_start;
+    std::vector<T> m_price{};
+    std::vector<std::uint32_t> m_owner{};
+
+    // Workspace of a round, the bid of each free row and the index of the best bid for each slot
+    std::vector<std::uint32_t> m_free{};
+    std::vector<std::uint32_t> m_next{};
+    std::vector<Bid> m_bid{};
+    std::vector<std::size_t> m_best{};
+    std::vector<std::uint32_t> m_touched{};
+
+    std::size_t m_phases = 0;
+    std::size_t m_rounds = 0;
+    std::size_t m_bids = 0;
+
+    [[nodiscard]] std::uint32_t column(std::uint32_t s) const {
+        return std::upper_bound(m_slot_start.begin(), m_slot_start.end(), s) - m_slot_start.begin()
+               - 1;
+    }
+
+    // Row i's bid from the current prices
+    [[nodiscard]] Bid bid(std::uint32_t i, T eps) const {
+        T constexpr inf = std::numeric_limits<T>::max();
+
+        T d1 = inf;
+        T d2 = inf;
+        std::uint32_t s1 = kicked;
+
+        auto consider = [&](std::uint32_t s, T d) {
+            if (d < d1) {
+                d2 = d1;
+                d1 = d;
+                s1 = s;
+            } else if (d < d2) {
+                d2 = d;
+            }
+        };
+
+        for (std::size_t e = m_c.row_start[i]; e < m_c.row_start[i + 1]; e++) {
+            std::uint32_t const j = m_c.col[e];
+            T const base = m_c.cost[e] * m_scale;
+
+            for (std::uint32_t s = m_slot_start[j]; s < m_slot_start[j + 1]; s++) {
+                consider(s, base + m_price[s]);
+            }
+        }
+
+        consider(kicked, m_c.kick[i] * m_scale);
+
+        if (s1 == kicked) {
+            return {kicked, 0};
+        }
+
+        return {s1, m_price[s1] + (d2 - d1) + eps};
+    }
+
+    // Award each slot to its best bid, the losers and the displaced owners bid next round
+    void resolve() {
+        m_next.clear();
+        m_touched.clear();
+
+        for (std::size_t k = 0; k < m_free.size(); k++) {
+            std::uint32_t const s = m_bid[k].slot;
+
+            if (s == kicked) {
+                m_rowsol[m_free[k]] = kicked;
+            } else if (m_best[s] == none) {
+                m_best[s] = k;
+                m_touched.push_back(s);
+            } else if (m_bid[k].price > m_bid[m_best[s]].price) {
+                m_next.push_back(m_free[m_best[s]]);
+                m_best[s] = k;
+            } else {
+                m_next.push_back(m_free[k]);
+            }
+        }
+
+        for (std::uint32_t s : m_touched) {
+            std::uint32_t const i = m_free[m_best[s]];
+
+            if (m_owner[s] != unassigned) {
+                m_rowsol[m_owner[s]] = unassigned;
+                m_next.push_back(m_owner[s]);
+            }
+
+            m_owner[s] = i;
+            m_rowsol[i] = s;
+            m_price[s] = m_bid[m_best[s]].price;
+            m_best[s] = none;
+        }
+
+        m_bids += m_free.size();
+        m_rounds += 1;
+
+        std::sort(m_next.begin(), m_next.end());
+        std::swap(m_free, m_next);
+    }
+
+    // Auction every row from the current prices until all are assigned
+    void phase(T eps) {
+        std::fill(m_rowsol.begin(), m_rowsol.end(), unassigned);
+        std::fill(m_owner.begin(), m_owner.end(), unassigned);
+
+        m_free.resize(m_c.rows());
+
+        for (std::uint32_t i = 0; i < m_c.rows(); i++) {
+            m_free[i] = i;
+        }
+
+        m_next.reserve(m_c.rows());
+        m_touched.reserve(m_price.size());
+        m_bid.resize(m_c.rows());
+        m_phases += 1;
+
+        // A team of threads kept for the whole phase, the last to finish a round resolves it
+        std::size_t const team = std::min(resolve_threads(m_threads), m_c.rows());
+
+        std::barrier sync(team, [this]() noexcept { resolve(); });
+
+        parallel_for(team, m_threads, [&](std::size_t t, std::size_t) {
+            while (!m_free.empty()) {
+                std::size_t const n = m_free.size();
+
+                for (std::size_t k = n * t / team; k < n * (t + 1) / team; k++) {
+                    m_bid[k] = bid(m_free[k], eps);
+                }
+
+                sync.arrive_and_wait();
+            }
+        });
+    }
+};
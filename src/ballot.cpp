@@ -6,74 +6,50 @@
 
 #include "ballot.hpp"
 
+#include <algorithm>
+#include <charconv>
 #include <fstream>
 #include <iomanip>
 #include <iterator>
+#include <map>
 #include <set>
 #include <sstream>
 #include <stdexcept>
 #include <string>
+#include <system_error>
 #include <tuple>
 #include <type_traits>
 #include <utility>
 #include <vector>
 
-#include "csv2/parameters.hpp"
-#include "csv2/reader.hpp"
+#include "ingest.hpp"
 #include "secrets.hpp"
 
-// Reads csv-file, expects header and columns: name, crsid, priority, choice 1, ..., choice n
-std::vector<Person> parse_people(std::string const& fname) {
-    // Have to manually include carriage return ('\r')
-    csv2::Reader<csv2::delimiter<','>,
-                 csv2::quote_character<'"'>,
-                 csv2::first_row_is_header<false>,
-                 csv2::trim_policy::trim_characters<' ', '\r', '\n'>>
-        csv;
+// Reads csv-file, expects columns: name, crsid, priority, choice 1, ..., choice n
+PeopleCsv read_people(std::string const& fname) {
+    PeopleCsv csv{fname};  // Throws if no file
 
-    csv.mmap(fname);  // Throws if no file
-
-    std::vector<Person> people;
+    if (csv.size() == 0) {
+        throw std::runtime_error("No people in csv");
+    }
 
-    for (std::string buff; const auto row : csv) {
-        impl::Person real_p;
-        std::size_t count = 0;
-        for (const auto cell : row) {
-            switch (count++) {
-                case 0:
-                    cell.read_value(real_p.name);
-                    break;
-                case 1:
-                    cell.read_value(real_p.crsid);
-                    break;
-                case 2:
-                    buff.clear();
-                    cell.read_value(buff);
-                    real_p.priority = std::stoi(buff);
-                    break;
-                default:
-                    buff.clear();
-                    cell.read_value(buff);
-                    real_p.pref.push_back(buff);
-            }
-        }
+    return csv;
+}
 
-        people.emplace_back(std::move(real_p));
-    }
+std::vector<Person> parse_people(PeopleCsv const& csv, std::vector<std::size_t> const& rows) {
+    std::vector<Person> people;
 
-    // Verify all people have made the same number of choices and that there is at least one person.
+    people.reserve(rows.size());
 
-    if (people.empty()) {
-        throw std::runtime_error("No people in csv");
-    }
+    for (std::size_t i : rows) {
+        impl::Person real_p;
 
-    std::size_t const k = people[0]->pref.size();
+        real_p.name = csv.name(i);
+        real_p.crsid = csv.crsid(i);
+        real_p.priority = csv.priority(i);
+        real_p.pref.assign(csv.pref(i).begin(), csv.pref(i).end());
 
-    for (auto const& p : people) {
-        if (p->pref.size() != k) {
-            throw std::runtime_error(
-                "Not all people have made the same number of choices, maybe a trailing newline");
-        }
+        people.emplace_back(std::move(real_p));
     }
 
     return people;
@@ -98,6 +74,110 @@ std::vector<Room> find_rooms(std::vector<Person> const& people) {
     return {rooms.begin(), rooms.end()};
 }
 
+// Reads csv-file, expects columns: room, capacity. Rooms not listed have capacity one.
+std::map<std::string, std::size_t> parse_capacities(std::string const& fname) {
+    std::map<std::string, std::size_t> capacities;
+
+    for (auto&& [row, cells] : CsvLines{fname}) {
+        if (cells.size() != 2) {
+            throw std::runtime_error("Capacities csv should have two columns");
+        }
+
+        capacities[std::string{cells[0]}] = parse_size(cells[1], "capacity", row);
+    }
+
+    return capacities;
+}
+
+// Reads csv-file of verification requests, expects columns: index, one_time_pad
+std::vector<std::pair<std::size_t, std::string>> parse_pairs(std::string const& fname) {
+    std::vector<std::pair<std::size_t, std::string>> pairs;
+
+    for (auto&& [row, cells] : CsvLines{fname}) {
+        if (cells.size() != 2) {
+            throw std::runtime_error("Pairs csv should have two columns");
+        }
+
+        pairs.emplace_back(parse_size(cells[0], "index", row), cells[1]);
+    }
+
+    return pairs;
+}
+
+// Reads a secret ballot, columns: name, crsid, priority, choice, room, index, one_time_pad. The
+// priority, choice and room are recomputed from the public ballot.
+std::vector<impl::Person> parse_secret(std::string const& fname) {
+    std::vector<impl::Person> people;
+
+    for (auto&& [row, cells] : CsvLines{fname}) {
+        if (cells.size() != 7) {
+            throw std::runtime_error("Secret ballot should have seven columns");
+        }
+
+        impl::Person p;
+
+        p.name = cells[0];
+        p.crsid = cells[1];
+        p.index = parse_size(cells[5], "index", row);
+        p.one_time_pad = cells[6];
+
+        people.push_back(std::move(p));
+    }
+
+    return people;
+}
+
+// Reads csv-file of changes, rows are either: +, name, crsid, priority, choice 1, ..., choice n to
+// add a person or: -, name to remove one
+Delta parse_delta(std::string const& fname) {
+    Delta delta;
+
+    for (auto&& [row, cells] : CsvLines{fname}) {
+        if (cells.size() == 2 && cells[0] == "-") {
+            delta.removed.emplace_back(cells[1]);
+        } else if (cells.size() >= 4 && cells[0] == "+") {
+            impl::Person real_p;
+
+            real_p.name = cells[1];
+            real_p.crsid = cells[2];
+            real_p.priority = parse_size(cells[3], "priority", row);
+            real_p.pref.assign(cells.begin() + 4, cells.end());
+
+            if (std::count(real_p.pref.begin(), real_p.pref.end(), "") > 0) {
+                throw std::runtime_error("Empty choice on line " + std::to_string(row)
+                                         + ", maybe a trailing comma");
+            }
+
+            delta.added.emplace_back(std::move(real_p));
+        } else {
+            throw std::runtime_error("Delta rows should be: +, name, crsid, priority, choices...");
+        }
+    }
+
+    return delta;
+}
+
+std::pair<std::size_t, std::size_t> parse_range(std::string const& range) {
+    std::size_t a = 0;
+    std::size_t b = 0;
+
+    char const* const last = range.data() + range.size();
+
+    auto [mid, ec1] = std::from_chars(range.data(), last, a);
+
+    if (ec1 != std::errc{} || mid == last || *mid != ':') {
+        throw std::invalid_argument("Expected a range like 10:20, got " + range);
+    }
+
+    auto [end, ec2] = std::from_chars(mid + 1, last, b);
+
+    if (ec2 != std::errc{} || end != last || b < a) {
+        throw std::invalid_argument("Expected a range like 10:20, got " + range);
+    }
+
+    return {a, b};
+}
+
 void write_results(std::vector<std::pair<Person, Room>> const& result, Args const& args) {
     // Find longest name
     std::size_t w = [&] {
@@ -140,11 +220,17 @@ void write_results(std::vector<std::pair<Person, Room>> const& result, Args cons
     }
 }
 
-void highlight_results(std::vector<std::pair<Person, Room>> const& results, Args const& args) {
-    auto&& [person, room] = results[args.verify.index];
+void highlight_results(std::vector<std::pair<Person, Room>> const& results,
+                       std::size_t index,
+                       std::string const& one_time_pad) {
+    if (index >= results.size()) {
+        throw std::out_of_range("No one in the ballot has index " + std::to_string(index));
+    }
+
+    auto&& [person, room] = results[index];
 
     std::cout << "-- Your name is : ";
-    std::cout << string_xor(person->secret_name, args.verify.one_time_pad) << '\n';
+    std::cout << string_xor(person->secret_name, one_time_pad) << '\n';
 
     std::cout << "-- Your choices :";
 
@@ -10,10 +10,12 @@
 #include <iomanip>
 #include <iostream>
 #include <iterator>
+#include <map>
 #include <optional>
 #include <string>
 #include <vector>
 
+#include "ingest.hpp"
 #include "structopt/app.hpp"
 #include "structopt/sub_command.hpp"
 
@@ -21,11 +23,38 @@
 
 // Argument parsing
 
+// Assignment backends, the one used is recorded in the public ballot by value so only append
+enum class Solver {
+    lapjv,    // Dense, square, padded LAPJV
+    sparse,   // Min-cost flow over the preference edges only
+    dense,    // Dense, rectangular, without null people
+    jv,       // As lapjv but vectorised and multi-threaded, see jv.hpp
+    auction,  // Parallel auction over the preference edges, see auction.hpp
+};
+
+// Formats of the public ballot
+enum class Format {
+    json,    // Human readable
+    binary,  // Compact and quick to parse
+};
+
 struct Args {
     struct Verify : structopt::sub_command {
         std::size_t index;
         std::string one_time_pad;                                     // Verifies this name
         std::optional<std::string> in_public = "public_ballot.json";  // Public ballot file
+        std::optional<std::size_t> threads = 1;                         // Zero for all cores
+        std::optional<bool> resolve = false;  // Re-solve instead of checking the certificate
+        std::optional<std::string> profile;   // Write phase times and solver counters here
+    };
+
+    // As verify for every (index, one_time_pad) pair in a csv, from a single solve
+    struct Batch : structopt::sub_command {
+        std::string in_pairs;                                         // Csv of: index, one_time_pad
+        std::optional<std::string> in_public = "public_ballot.json";  // Public ballot file
+        std::optional<std::size_t> threads = 1;                         // Zero for all cores
+        std::optional<bool> resolve = false;  // Re-solve instead of checking the certificate
+        std::optional<std::string> profile;   // Write phase times and solver counters here
     };
 
     struct Run : structopt::sub_command {
@@ -35,6 +64,15 @@ struct Args {
         std::optional<std::string> out_public = "public_ballot.json";  // Write anonymised here
         std::optional<std::size_t> max_rooms;                          // Maximum num rooms to use
         std::optional<std::vector<std::string>> hostels;               // List of hostels
+        std::optional<Solver> solver = Solver::lapjv;                  // Assignment backend
+        std::optional<std::size_t> threads = 1;                        // Zero for all cores
+        std::optional<std::string> capacities;                         // Csv of: room, capacity
+        std::optional<Format> format;  // Of the public ballot, default by extension
+        std::optional<bool> components = false;  // Solve connected components independently
+        std::optional<std::string> max_rooms_range;  // Summarise each max_rooms in a:b, no output
+        std::optional<bool> presolve = false;        // Fix uncontested people before solving
+        std::optional<bool> integer = false;         // Fixed-point costs, exact arithmetic
+        std::optional<std::string> profile;          // Write phase times and solver counters here
     };
 
     struct Cycle : structopt::sub_command {
@@ -42,6 +80,64 @@ struct Args {
         std::vector<std::size_t> ks;
     };
 
+    // Run the ballot for every combination of the cost constants, writes the summaries to a csv
+    struct Sweep : structopt::sub_command {
+        std::string in_people;
+
+        std::optional<std::string> out = "sweep.csv";     // Write table here
+        std::optional<std::size_t> max_rooms;             // Maximum num rooms to use
+        std::optional<std::vector<std::string>> hostels;  // List of hostels
+        std::optional<std::string> capacities;            // Csv of: room, capacity
+        std::optional<Solver> solver = Solver::sparse;    // Assignment backend
+        std::optional<std::size_t> threads = 0;           // Zero for all cores
+
+        // Values of each cost constant to try, the one in cost.hpp if missing
+        std::optional<std::vector<double>> bias_fist;
+        std::optional<std::vector<double>> kick_cost;
+        std::optional<std::vector<double>> p_weight;
+        std::optional<std::vector<double>> hostel_penalty;
+    };
+
+    // Near-duplicate choices, found with MinHash and locality-sensitive hashing
+    struct Similar : structopt::sub_command {
+        std::string in_people;
+        std::optional<double> threshold = 0.6;  // Minimum Jaccard similarity of sets of choices
+        std::optional<std::size_t> bands = 16;  // Number of LSH bands
+        std::optional<std::size_t> rows = 4;    // MinHashes per band
+    };
+
+    // Add and remove people from a ballot that has been run, repairing rather than re-solving it
+    struct Amend : structopt::sub_command {
+        std::string in_delta;  // Csv of: +, name, crsid, priority, choices... or: -, name
+
+        std::optional<std::string> in_public = "public_ballot.json";   // Previous public ballot
+        std::optional<std::string> in_secret = "secret_ballot.csv";    // Previous secret ballot
+        std::optional<std::string> out_secret = "secret_ballot.csv";   // Write results here
+        std::optional<std::string> out_public = "public_ballot.json";  // Write anonymised here
+    };
+
+    // What each person would have got with priority 1, their first two choices swapped, and who
+    // moves if they withdraw
+    struct Explain : structopt::sub_command {
+        std::optional<std::string> in_public = "public_ballot.json";  // Public ballot file
+        std::optional<std::string> out = "explain.csv";               // Write table here
+        std::optional<std::size_t> threads = 0;                       // Zero for all cores
+    };
+
+    // Re-run the ballot under many alternative shuffles, counting each person's outcomes
+    struct Fairness : structopt::sub_command {
+        std::string in_people;
+
+        std::optional<std::string> out = "fairness.csv";  // Write table here
+        std::optional<std::size_t> orders = 100;          // Number of shuffles, the first is run's
+        std::optional<std::size_t> max_rooms;             // Maximum num rooms to use
+        std::optional<std::vector<std::string>> hostels;  // List of hostels
+        std::optional<std::string> capacities;            // Csv of: room, capacity
+        std::optional<Solver> solver = Solver::lapjv;     // Assignment backend, as run
+        std::optional<bool> integer = false;              // Fixed-point costs
+        std::optional<std::size_t> threads = 0;           // Zero for all cores
+    };
+
     Args() = default;  // Required by structopt, cereal
 
     // Exceptions handled in constructor
@@ -54,15 +150,65 @@ struct Args {
 
     // Subcommands
     Verify verify;
+    Batch batch;
     Run run;
     Cycle cycle;
+    Similar similar;
+    Sweep sweep;
+    Amend amend;
+    Explain explain;
+    Fairness fairness;
 };
 
-STRUCTOPT(Args::Verify, index, one_time_pad);
-STRUCTOPT(Args::Run, in_people, out_secret, out_public, max_rooms, hostels);
+STRUCTOPT(Args::Verify, index, one_time_pad, in_public, threads, resolve, profile);
+STRUCTOPT(Args::Batch, in_pairs, in_public, threads, resolve, profile);
+STRUCTOPT(Args::Run,
+          in_people,
+          out_secret,
+          out_public,
+          max_rooms,
+          hostels,
+          solver,
+          threads,
+          capacities,
+          format,
+          components,
+          max_rooms_range,
+          presolve,
+          integer,
+          profile);
 STRUCTOPT(Args::Cycle, in_people, ks);
-
-STRUCTOPT(Args, run, verify, cycle);
+STRUCTOPT(Args::Similar, in_people, threshold, bands, rows);
+
+STRUCTOPT(Args::Sweep,
+          in_people,
+          out,
+          max_rooms,
+          hostels,
+          capacities,
+          solver,
+          threads,
+          bias_fist,
+          kick_cost,
+          p_weight,
+          hostel_penalty);
+
+STRUCTOPT(Args::Amend, in_delta, in_public, in_secret, out_secret, out_public);
+
+STRUCTOPT(Args::Explain, in_public, out, threads);
+
+STRUCTOPT(Args::Fairness,
+          in_people,
+          out,
+          orders,
+          max_rooms,
+          hostels,
+          capacities,
+          solver,
+          integer,
+          threads);
+
+STRUCTOPT(Args, run, verify, batch, cycle, similar, sweep, amend, explain, fairness);
 
 /////////////////////////////////////////////////////////////////////////////
 
@@ -105,13 +251,37 @@ using Room = std::optional<std::string>;
 
 /////////////////////////////////////////////////////////////////////////////
 
-std::vector<Person> parse_people(std::string const&);
+// The people of a csv, see PeopleCsv, throws if there are none
+PeopleCsv read_people(std::string const&);
+
+// Build the people of the given rows of a csv, in that order
+std::vector<Person> parse_people(PeopleCsv const&, std::vector<std::size_t> const& rows);
 
 std::vector<Room> find_rooms(std::vector<Person> const&);
 
+std::map<std::string, std::size_t> parse_capacities(std::string const&);
+
+std::vector<std::pair<std::size_t, std::string>> parse_pairs(std::string const&);
+
+// Name, crsid, index and one_time_pad of everyone in a secret ballot written by write_results
+std::vector<impl::Person> parse_secret(std::string const&);
+
+// People to add to and names to remove from a ballot
+struct Delta {
+    std::vector<Person> added{};
+    std::vector<std::string> removed{};
+};
+
+Delta parse_delta(std::string const&);
+
+// Parse "a:b" into {a, b}
+std::pair<std::size_t, std::size_t> parse_range(std::string const&);
+
 void write_results(std::vector<std::pair<Person, Room>> const&, Args const&);
 
-void highlight_results(std::vector<std::pair<Person, Room>> const&, Args const&);
+void highlight_results(std::vector<std::pair<Person, Room>> const&,
+                       std::size_t index,
+                       std::string const& one_time_pad);
 
 template <typename F>
 void analayse(std::vector<std::pair<Person, Room>> const& results, F&& is_hostel) {
@@ -0,0 +1,79 @@
+// Copyright (C) 2020 Conor Williams
+
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include "cache.hpp"
+
+#include <exception>
+#include <fstream>
+#include <iterator>
+#include <optional>
+#include <stdexcept>
+#include <string>
+
+#include "cereal/archives/json.hpp"
+#include "cereal/types/optional.hpp"
+#include "cereal/types/string.hpp"
+#include "cereal/types/vector.hpp"
+#include "picosha2.h"
+#include "solve.hpp"
+
+namespace {  // Like static
+
+std::string cache_name(std::string const& fname) { return fname + ".cache"; }
+
+}  // namespace
+
+std::string hash_file(std::string const& fname) {
+    std::ifstream file(fname, std::ios::binary);
+
+    if (!file) {
+        throw std::runtime_error("Could not open " + fname);
+    }
+
+    std::string bytes{std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+
+    return picosha2::hash256_hex_string(bytes);
+}
+
+std::optional<Solution> load_cache(std::string const& fname, std::string const& hash) {
+    std::ifstream file(cache_name(fname));
+
+    if (!file) {
+        return std::nullopt;
+    }
+
+    // A stale or corrupt cache is a miss
+    try {
+        cereal::JSONInputArchive archive(file);
+
+        std::string key;
+        Solution solution;
+
+        archive(key, solution);
+
+        if (key == hash) {
+            return solution;
+        }
+    } catch (std::exception const&) {
+    }
+
+    return std::nullopt;
+}
+
+bool save_cache(std::string const& fname, std::string const& hash, Solution const& solution) {
+    std::ofstream file(cache_name(fname));
+
+    if (!file) {
+        return false;
+    }
+
+    {
+        cereal::JSONOutputArchive archive(file);
+        archive(hash, solution);
+    }
+
+    return static_cast<bool>(file);
+}
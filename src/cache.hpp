@@ -0,0 +1,28 @@
+// Copyright (C) 2020 Conor Williams
+
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <optional>
+#include <string>
+
+#include "solve.hpp"
+
+/*
+ *  On-disk cache of solved ballots. The solution of the public ballot "fname" is stored next to it
+ *  in "fname.cache" keyed by the SHA-256 of the public ballot, hence any change to the ballot
+ *  invalidates the cache. The key is no secret, so callers must check a cached solution's
+ *  certificate before trusting it.
+ */
+
+// Hex SHA-256 of the file's contents, throws if no file
+std::string hash_file(std::string const& fname);
+
+// Cached solution of the ballot with the given hash, nullopt if there is none
+std::optional<Solution> load_cache(std::string const& fname, std::string const& hash);
+
+// Failing to write the cache is not an error, returns true if written
+bool save_cache(std::string const& fname, std::string const& hash, Solution const&);
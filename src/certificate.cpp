@@ -0,0 +1,81 @@
+// Copyright (C) 2020 Conor Williams
+
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include "certificate.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "cohort.hpp"
+#include "cost.hpp"
+#include "solve.hpp"
+
+namespace {  // Like static
+
+// Absolute tolerance, costs are O(1) and the duals are sums of a handful of them
+constexpr double eps = 1e-9;
+
+void require(bool ok, std::string const& what) {
+    if (!ok) {
+        throw std::runtime_error("Invalid certificate: " + what);
+    }
+}
+
+}  // namespace
+
+void check_certificate(Cohort const& c, CostTable const& t, Solution const& sol) {
+    std::size_t const n = c.num_people();
+    std::size_t const m = c.num_rooms();
+
+    require(sol.allocation.size() == n && sol.u.size() == n, "wrong number of people");
+    require(sol.v.size() == m, "wrong number of rooms");
+    require(t.kick_cost() < t.big_num(), "kicking must be cheaper than an unwanted room");
+
+    std::vector<std::uint32_t> load(m, 0);
+
+    for (std::uint32_t i = 0; i < n; i++) {
+        // Dual feasibility, including the kick option (potential zero)
+        require(sol.u[i] <= t.kick_cost() + eps, "kick reduced cost negative");
+
+        for (std::size_t e = c.row_start[i]; e < c.row_start[i + 1]; e++) {
+            std::uint32_t r = c.room[e];
+
+            if (c.capacity[r] == 0) {
+                continue;  // Not an option
+            }
+
+            double reduced = t.choice(i, c.rank[e], c.hostel[r]) - sol.u[i] - sol.v[r];
+            require(reduced >= -eps, "reduced cost negative");
+        }
+
+        // Complementary slackness, allocated option must have zero reduced cost
+        if (std::optional r = sol.allocation[i]) {
+            require(*r < m, "unknown room");
+
+            std::optional rank = c.choice_index(i, *r);
+
+            require(rank.has_value(), "person allocated a room they did not choose");
+
+            double reduced = t.choice(i, *rank, c.hostel[*r]) - sol.u[i] - sol.v[*r];
+
+            require(reduced <= eps, "allocated room not tight");
+
+            ++load[*r];
+        } else {
+            require(t.kick_cost() - sol.u[i] <= eps, "kick not tight");
+        }
+    }
+
+    for (std::uint32_t r = 0; r < m; r++) {
+        require(load[r] <= c.capacity[r], "room over capacity");
+        require(sol.v[r] <= eps, "room potential positive");
+        require(sol.v[r] >= -eps || load[r] == c.capacity[r], "negative potential but not full");
+    }
+}
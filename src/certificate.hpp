@@ -0,0 +1,19 @@
+// Copyright (C) 2020 Conor Williams
+
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include "cohort.hpp"
+#include "cost.hpp"
+#include "solve.hpp"
+
+/*
+ *  Check in a single O(people x choices) pass that the solution's duals prove its allocation is a
+ *  global minimum of the cost function (complementary slackness + non-negative reduced costs).
+ *  Unchosen rooms cost big_num > kick_cost so can never beat kicking and need not be checked.
+ *  Throws std::runtime_error describing the first violation found.
+ */
+void check_certificate(Cohort const&, CostTable const&, Solution const&);
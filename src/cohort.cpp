@@ -0,0 +1,246 @@
+// Copyright (C) 2020 Conor Williams
+
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include "cohort.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "ballot.hpp"
+#include "ingest.hpp"
+
+std::optional<std::uint32_t> Cohort::room_id(std::string_view name) const {
+    auto it = std::lower_bound(rooms.begin(), rooms.end(), name);
+
+    if (it != rooms.end() && *it == name) {
+        return it - rooms.begin();
+    }
+    return std::nullopt;
+}
+
+std::optional<std::uint32_t> Cohort::choice_index(std::size_t person, std::uint32_t r) const {
+    auto first = room.begin() + row_start[person];
+    auto last = room.begin() + row_start[person + 1];
+
+    // Linear scan beats binary search for the typical handful of choices
+    for (auto it = first; it != last && *it <= r; ++it) {
+        if (*it == r) {
+            return rank[it - room.begin()];
+        }
+    }
+    return std::nullopt;
+}
+
+namespace {  // Like static
+
+using RoomIds = std::unordered_map<std::string_view, std::uint32_t>;
+
+// Append a room, hostels are matched by prefix. The name is the key of its id so must outlive ids.
+void add_room(Cohort& c,
+              RoomIds& ids,
+              std::string_view name,
+              std::optional<std::vector<std::string>> const& hostels,
+              std::map<std::string, std::size_t> const& capacities) {
+    bool is_hostel = false;
+
+    if (hostels) {
+        for (auto&& prefix : *hostels) {
+            is_hostel |= name.starts_with(prefix);
+        }
+    }
+
+    auto cap = capacities.find(std::string{name});
+
+    ids.emplace(name, c.rooms.size());
+    c.rooms.emplace_back(name);
+    c.hostel.push_back(is_hostel);
+    c.capacity.push_back(cap == capacities.end() ? 1 : cap->second);
+}
+
+// Append a person, row is workspace
+template <typename Pref>
+void add_person(Cohort& c,
+                RoomIds const& ids,
+                std::size_t priority,
+                Pref const& pref,
+                std::vector<std::pair<std::uint32_t, std::uint32_t>>& row) {
+    c.priority.push_back(priority);
+    c.n_pref.push_back(pref.size());
+
+    row.clear();
+
+    for (std::uint32_t i = 0; i < pref.size(); i++) {
+        if (auto it = ids.find(pref[i]); it != ids.end()) {
+            row.emplace_back(it->second, i);
+        } else {
+            throw std::invalid_argument("Person chose a room not in the room list");
+        }
+    }
+
+    // Sort by room then rank such that the first occurrence of each room survives unique
+    std::sort(row.begin(), row.end());
+
+    auto last = std::unique(row.begin(), row.end(), [](auto const& a, auto const& b) {
+        return a.first == b.first;
+    });
+
+    for (auto it = row.begin(); it != last; ++it) {
+        c.room.push_back(it->first);
+        c.rank.push_back(it->second);
+    }
+
+    c.row_start.push_back(c.room.size());
+}
+
+}  // namespace
+
+Cohort intern(std::vector<Person> const& people,
+              std::vector<Room> const& rooms,
+              std::optional<std::vector<std::string>> const& hostels,
+              std::map<std::string, std::size_t> const& capacities) {
+    Cohort c;
+
+    RoomIds ids;
+
+    for (auto const& r : rooms) {
+        if (!r) {
+            throw std::invalid_argument("Cannot intern null room");
+        }
+
+        add_room(c, ids, *r, hostels, capacities);
+    }
+
+    std::vector<std::pair<std::uint32_t, std::uint32_t>> row;
+
+    for (auto const& p : people) {
+        if (!p) {
+            throw std::invalid_argument("Cannot intern null person");
+        }
+
+        add_person(c, ids, p->priority, p->pref, row);
+    }
+
+    return c;
+}
+
+Cohort intern(PeopleCsv const& csv,
+              std::vector<std::size_t> const& rows,
+              std::optional<std::vector<std::string>> const& hostels,
+              std::map<std::string, std::size_t> const& capacities) {
+    // Sorted and distinct, as find_rooms
+    std::vector<std::string_view> rooms;
+
+    rooms.reserve(rows.size() * csv.choices());
+
+    for (std::size_t i : rows) {
+        rooms.insert(rooms.end(), csv.pref(i).begin(), csv.pref(i).end());
+    }
+
+    std::sort(rooms.begin(), rooms.end());
+
+    rooms.erase(std::unique(rooms.begin(), rooms.end()), rooms.end());
+
+    Cohort c;
+
+    RoomIds ids;
+
+    for (std::string_view r : rooms) {
+        add_room(c, ids, r, hostels, capacities);
+    }
+
+    std::vector<std::pair<std::uint32_t, std::uint32_t>> row;
+
+    for (std::size_t i : rows) {
+        add_person(c, ids, csv.priority(i), csv.pref(i), row);
+    }
+
+    return c;
+}
+
+Components components(Cohort const& c) {
+    std::size_t const n = c.num_people();
+    std::size_t const m = c.num_rooms();
+
+    // Union-find over people [0, n) and rooms [n, n + m)
+    std::vector<std::size_t> parent(n + m);
+
+    for (std::size_t i = 0; i < n + m; i++) {
+        parent[i] = i;
+    }
+
+    auto find = [&](std::size_t x) {
+        while (parent[x] != x) {
+            x = parent[x] = parent[parent[x]];
+        }
+        return x;
+    };
+
+    for (std::size_t i = 0; i < n; i++) {
+        for (std::size_t e = c.row_start[i]; e < c.row_start[i + 1]; e++) {
+            parent[find(i)] = find(n + c.room[e]);
+        }
+    }
+
+    constexpr std::uint32_t unset = UINT32_MAX;
+
+    std::vector<std::uint32_t> label(n + m, unset);
+
+    Components comp;
+
+    for (std::size_t i = 0; i < n + m; i++) {
+        std::size_t root = find(i);
+
+        if (label[root] == unset) {
+            label[root] = comp.count++;
+        }
+
+        (i < n ? comp.person : comp.room).push_back(label[root]);
+    }
+
+    return comp;
+}
+
+Cohort sub_cohort(Cohort const& c,
+                  std::vector<std::uint32_t> const& people,
+                  std::vector<std::uint32_t> const& rooms) {
+    Cohort s;
+
+    for (std::uint32_t r : rooms) {
+        s.rooms.push_back(c.rooms[r]);
+        s.hostel.push_back(c.hostel[r]);
+        s.capacity.push_back(c.capacity[r]);
+    }
+
+    for (std::uint32_t i : people) {
+        s.priority.push_back(c.priority[i]);
+        s.n_pref.push_back(c.n_pref[i]);
+
+        for (std::size_t e = c.row_start[i]; e < c.row_start[i + 1]; e++) {
+            auto it = std::lower_bound(rooms.begin(), rooms.end(), c.room[e]);
+
+            if (it == rooms.end() || *it != c.room[e]) {
+                throw std::invalid_argument("Sub-cohort is missing a chosen room");
+            }
+
+            // Rooms are increasing hence choices stay sorted by room id
+            s.room.push_back(it - rooms.begin());
+            s.rank.push_back(c.rank[e]);
+        }
+
+        s.row_start.push_back(s.room.size());
+    }
+
+    return s;
+}
@@ -0,0 +1,79 @@
+// Copyright (C) 2020 Conor Williams
+
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "ballot.hpp"
+#include "ingest.hpp"
+
+/*
+ *  Integer symbol table for the people/rooms in a ballot, built once before solving such that the
+ *  cost function is a handful of integer lookups. Person ids are indices into the people vector it
+ *  was built from, room ids are indices into the (sorted) vector of rooms.
+ */
+struct Cohort {
+    std::vector<std::string> rooms{};  // Room id -> name
+    std::vector<bool> hostel{};        // Room id -> is a hostel
+
+    std::vector<std::uint32_t> capacity{};  // Room id -> number of people it can take
+
+    std::vector<std::size_t> priority{};  // Person id -> priority
+    std::vector<std::size_t> n_pref{};    // Person id -> number of choices made
+
+    // Person i's distinct choices are [row_start[i], row_start[i + 1]) sorted by room id
+    std::vector<std::size_t> row_start{0};
+    std::vector<std::uint32_t> room{};  // Room id of choice
+    std::vector<std::uint32_t> rank{};  // Choice index (first occurrence) of room
+
+    [[nodiscard]] std::size_t num_people() const { return priority.size(); }
+
+    [[nodiscard]] std::size_t num_rooms() const { return rooms.size(); }
+
+    // Id of a room by name
+    [[nodiscard]] std::optional<std::uint32_t> room_id(std::string_view name) const;
+
+    // Equivalent of impl::Person::choice_index for interned person/room
+    [[nodiscard]] std::optional<std::uint32_t> choice_index(std::size_t person,
+                                                            std::uint32_t room) const;
+};
+
+// Build the symbol table, hostels are matched by prefix as in the run subcommand, rooms missing
+// from capacities can take one person.
+Cohort intern(std::vector<Person> const& people,
+              std::vector<Room> const& rooms,
+              std::optional<std::vector<std::string>> const& hostels,
+              std::map<std::string, std::size_t> const& capacities = {});
+
+// As above for the given rows of a csv, in that order, and the rooms they chose, straight from the
+// views of the csv without building the people
+Cohort intern(PeopleCsv const& csv,
+              std::vector<std::size_t> const& rows,
+              std::optional<std::vector<std::string>> const& hostels,
+              std::map<std::string, std::size_t> const& capacities = {});
+
+// Connected components of the bipartite graph of people and the rooms they chose, numbered in order
+// of their lowest person id (rooms no one chose come last, one component each).
+struct Components {
+    std::size_t count = 0;
+    std::vector<std::uint32_t> person{};  // Person id -> component
+    std::vector<std::uint32_t> room{};    // Room id -> component
+};
+
+Components components(Cohort const&);
+
+// The cohort restricted to the given people (in any order) and (increasing) rooms, every choice of
+// the people must be one of the rooms. Ids are positions in the given vectors.
+Cohort sub_cohort(Cohort const&,
+                  std::vector<std::uint32_t> const& people,
+                  std::vector<std::uint32_t> const& rooms);
@@ -8,56 +8,305 @@
 
 #include <algorithm>
 #include <cstddef>
+#include <cstdint>
 #include <iomanip>
 #include <iostream>
-#include <set>
+#include <map>
+#include <span>
+#include <stdexcept>
+#include <string_view>
+#include <unordered_map>
 #include <vector>
 
-#include "ballot.hpp"
+#include "ingest.hpp"
 
-void report_k_cycles(std::size_t k, std::vector<Person> const& people) {
-    //
-    struct AugPerson : impl::Person {
-        std::set<std::string> sub_pref;
-    };
+namespace {  // Like static
+
+// Finaliser of splitmix64, a strong mix of a room id
+std::uint64_t mix(std::uint64_t x) {
+    x += 0x9e3779b97f4a7c15;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111eb;
+    return x ^ (x >> 31);
+}
 
-    std::vector<AugPerson> first_k;
+// Hash of a sequence of values
+template <typename It> std::uint64_t hash_range(It first, It last) {
+    std::uint64_t h = 0;
+    for (; first != last; ++first) {
+        h = mix(h ^ *first);
+    }
+    return h;
+}
 
-    for (auto&& p : people) {
-        if (p) {
-            first_k.push_back({
-                *p,
-                {p->pref.begin(), p->pref.begin() + std::min(k, p->pref.size())},
-            });
+// Representative of x's group, with path halving
+std::size_t find_root(std::vector<std::size_t>& parent, std::size_t x) {
+    while (parent[x] != x) {
+        x = parent[x] = parent[parent[x]];
+    }
+    return x;
+}
+
+// |a & b| / |a | b| of sorted sets
+double jaccard(std::vector<std::uint32_t> const& a, std::vector<std::uint32_t> const& b) {
+    std::size_t common = 0;
+
+    for (auto i = a.begin(), j = b.begin(); i != a.end() && j != b.end();) {
+        if (*i < *j) {
+            ++i;
+        } else if (*j < *i) {
+            ++j;
+        } else {
+            ++common, ++i, ++j;
         }
     }
 
-    // Find longest name for pretty print
+    std::size_t all = a.size() + b.size() - common;
+
+    return all ? static_cast<double>(common) / all : 1;
+}
+
+// Print a group of people and the first k of their choices
+void print_group(PeopleCsv const& csv,
+                 std::vector<std::size_t> const& group,
+                 std::size_t w,
+                 std::size_t k) {
+    for (std::size_t i : group) {
+        std::cout << "--" << std::right << std::setw(w + 2) << csv.name(i) << " : ";
+        for (std::size_t c = 0; c < std::min(k, csv.choices()); c++) {
+            std::cout << std::left << std::setw(5) << csv.pref(i)[c];
+        }
+
+        std::cout << '\n';
+    }
+    std::cout << "--\n";
+}
+
+// Everyone's choices as interned room ids, person i's are [i * choices, (i + 1) * choices)
+std::vector<std::uint32_t> intern_choices(PeopleCsv const& csv) {
+    std::unordered_map<std::string_view, std::uint32_t> ids;
+
+    std::vector<std::uint32_t> pref;
+
+    pref.reserve(csv.size() * csv.choices());
+
+    for (std::size_t i = 0; i < csv.size(); i++) {
+        for (std::string_view r : csv.pref(i)) {
+            pref.push_back(ids.try_emplace(r, ids.size()).first->second);
+        }
+    }
+
+    return pref;
+}
+
+// Longest name for pretty print
+std::size_t name_width(PeopleCsv const& csv) {
     std::size_t w = 0;
 
-    for (auto&& p : first_k) {
-        w = std::max(w, p.name.size());
+    for (std::size_t i = 0; i < csv.size(); i++) {
+        w = std::max(w, csv.name(i).size());
     }
 
-    for (auto it = first_k.begin(); it != first_k.end();) {
-        //
-        auto end = std::partition(it, first_k.end(), [s = *it](auto const& x) {  //
-            return x.sub_pref == s.sub_pref;
-        });
+    return w;
+}
+
+// Sorted distinct room ids of the first k choices
+std::vector<std::uint32_t> prefix_set(std::span<std::uint32_t const> pref, std::size_t k) {
+    std::vector<std::uint32_t> set(pref.begin(), pref.begin() + std::min(k, pref.size()));
+    std::sort(set.begin(), set.end());
+    set.erase(std::unique(set.begin(), set.end()), set.end());
+    return set;
+}
+
+}  // namespace
+
+void report_k_cycles(std::vector<std::size_t> const& ks, PeopleCsv const& csv) {
+    if (ks.empty()) {
+        return;
+    }
+
+    std::size_t const k_max = *std::max_element(ks.begin(), ks.end());
+
+    std::vector<std::uint32_t> const ids = intern_choices(csv);
 
-        if (end - it >= static_cast<std::ptrdiff_t>(k)) {
-            // Report choices
-            for (auto ix = it; ix != end; ++ix) {
-                std::cout << "--" << std::right << std::setw(w + 2) << ix->name << " : ";
-                for (std::size_t i = 0; i < k; i++) {
-                    std::cout << std::left << std::setw(5) << ix->pref[i];
+    auto pref = [&](std::size_t i) {
+        return std::span<std::uint32_t const>{ids.data() + i * csv.choices(), csv.choices()};
+    };
+
+    // The key of a set of rooms is the sum of the mixed ids of its (distinct) members, this is
+    // independent of order and updated in O(1) as each choice is added. Key -> people, per k.
+    std::map<std::size_t, std::unordered_map<std::uint64_t, std::vector<std::size_t>>> buckets;
+
+    for (std::size_t k : ks) {
+        if (k > 0) {
+            buckets[k];
+        }
+    }
+
+    for (std::size_t i = 0; i < csv.size(); i++) {
+        std::uint64_t key = 0;
+
+        auto it = buckets.begin();
+
+        for (std::size_t n = 0; n < k_max && it != buckets.end(); n++) {
+            if (n < csv.choices()) {
+                auto first = pref(i).begin();
+
+                if (std::find(first, first + n, pref(i)[n]) == first + n) {
+                    key += mix(pref(i)[n]);
                 }
+            }
+
+            // Prefixes longer than someone's choices are all of them
+            if (it->first == n + 1) {
+                it->second[key].push_back(i);
+                ++it;
+            }
+        }
+    }
+
+    std::size_t const w = name_width(csv);
+
+    for (std::size_t k : ks) {
+        if (k == 0) {
+            continue;
+        }
+
+        // Split buckets by exact set equality (guards against hash collisions)
+        std::vector<std::vector<std::size_t>> groups;
 
-                std::cout << '\n';
+        for (auto&& [key, members] : buckets[k]) {
+            if (members.size() < k) {
+                continue;
+            }
+
+            std::map<std::vector<std::uint32_t>, std::vector<std::size_t>> exact;
+
+            for (std::size_t i : members) {
+                exact[prefix_set(pref(i), k)].push_back(i);
+            }
+
+            for (auto&& [set, group] : exact) {
+                if (group.size() >= k) {
+                    groups.push_back(std::move(group));
+                }
             }
-            std::cout << "--\n";
         }
 
-        it = end;
+        // Deterministic output, groups ordered by their first member
+        std::sort(groups.begin(), groups.end());
+
+        std::cout << "-- Groups sharing their first " << k << " choices: " << groups.size() << '\n';
+
+        for (auto&& group : groups) {
+            print_group(csv, group, w, k);
+        }
+    }
+}
+
+void report_similar(PeopleCsv const& csv, double threshold, std::size_t bands, std::size_t rows) {
+    if (bands == 0 || rows == 0) {
+        throw std::invalid_argument("Need at least one band and row");
+    }
+
+    std::vector<std::uint32_t> const ids = intern_choices(csv);
+
+    std::size_t const n = csv.size();
+    std::size_t const k = csv.choices();
+
+    std::vector<std::vector<std::uint32_t>> sets;
+
+    for (std::size_t i = 0; i < n; i++) {
+        sets.push_back(prefix_set({ids.data() + i * k, k}, k));
+    }
+
+    std::vector<std::size_t> parent(n);
+
+    for (std::size_t i = 0; i < n; i++) {
+        parent[i] = i;
+    }
+
+    // Identical sets are linked directly, only one of each takes part in the LSH
+    std::vector<std::size_t> distinct;
+
+    {
+        std::map<std::vector<std::uint32_t>, std::size_t> first;
+
+        for (std::size_t i = 0; i < n; i++) {
+            if (auto [it, inserted] = first.try_emplace(sets[i], i); inserted) {
+                distinct.push_back(i);
+            } else {
+                parent[find_root(parent, i)] = find_root(parent, it->second);
+            }
+        }
+    }
+
+    // MinHash signatures, hash j of a room is mix(room + j-th odd constant)
+    std::vector<std::uint64_t> sig(bands * rows);
+
+    std::vector<std::unordered_map<std::uint64_t, std::vector<std::size_t>>> buckets(bands);
+
+    for (std::size_t i : distinct) {
+        std::fill(sig.begin(), sig.end(), UINT64_MAX);
+
+        for (std::uint32_t r : sets[i]) {
+            for (std::size_t j = 0; j < sig.size(); j++) {
+                sig[j] = std::min(sig[j], mix(r + (2 * j + 1) * 0x9e3779b97f4a7c15));
+            }
+        }
+
+        for (std::size_t b = 0; b < bands; b++) {
+            auto first = sig.begin() + b * rows;
+            buckets[b][hash_range(first, first + rows)].push_back(i);
+        }
+    }
+
+    // Exactly compare candidates that share a bucket
+    std::size_t compared = 0;
+
+    for (auto&& band : buckets) {
+        for (auto&& [key, members] : band) {
+            for (std::size_t a = 0; a < members.size(); a++) {
+                for (std::size_t b = a + 1; b < members.size(); b++) {
+                    std::size_t x = members[a];
+                    std::size_t y = members[b];
+
+                    if (find_root(parent, x) != find_root(parent, y)) {
+                        ++compared;
+
+                        if (jaccard(sets[x], sets[y]) >= threshold) {
+                            parent[find_root(parent, x)] = find_root(parent, y);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    std::map<std::size_t, std::vector<std::size_t>> components;
+
+    for (std::size_t i = 0; i < n; i++) {
+        components[find_root(parent, i)].push_back(i);
+    }
+
+    std::vector<std::vector<std::size_t>> groups;
+
+    for (auto&& [root, group] : components) {
+        if (group.size() > 1) {
+            groups.push_back(std::move(group));
+        }
+    }
+
+    // Deterministic output, groups ordered by their first member
+    std::sort(groups.begin(), groups.end());
+
+    std::cout << "-- Compared " << compared << " candidate pairs of " << n * (n - 1) / 2 << '\n';
+    std::cout << "-- Groups with similarity at least " << threshold << ": " << groups.size()
+              << '\n';
+
+    std::size_t const w = name_width(csv);
+
+    for (auto&& group : groups) {
+        print_group(csv, group, w, SIZE_MAX);
     }
-}
\ No newline at end of file
+}
@@ -6,8 +6,22 @@
 
 #pragma once
 
+#include <cstddef>
 #include <vector>
 
-#include "ballot.hpp"
+#include "ingest.hpp"
 
-void report_k_cycles(std::size_t k, std::vector<Person> const& people);
+// For each k report the groups of at least k people whose first k choices are the same set, all ks
+// are answered by a single pass over the people.
+void report_k_cycles(std::vector<std::size_t> const& ks, PeopleCsv const&);
+
+/*
+ *  Report the groups of people whose sets of choices have Jaccard similarity of at least threshold
+ *  (linking similar pairs transitively). Candidates are found by MinHash signatures of bands x rows
+ *  hashes, people sharing a band's hash are compared exactly, hence the time is roughly linear in
+ *  the number of people. Pairs less similar than about (1 / bands)^(1 / rows) are likely missed.
+ */
+void report_similar(PeopleCsv const&,
+                    double threshold,
+                    std::size_t bands = 16,
+                    std::size_t rows = 4);
@@ -7,35 +7,120 @@
 #pragma once
 
 #include <cmath>
+#include <cstddef>
+#include <cstdint>
 #include <iostream>
+#include <limits>
+#include <map>
 #include <optional>
 #include <stdexcept>
 #include <string>
+#include <type_traits>
+#include <utility>
 #include <variant>
+#include <vector>
 
 #include "ballot.hpp"
+#include "cohort.hpp"
 
-// Cost function - overall cost is minimised
-template <typename F> double cost_function(Person const& p, Room const& r, F&& is_hostel) {
-    // Constants
-    constexpr double bias_fist = 0.95;    // In (0,1)
-    constexpr double big_num = 100;       // Sufficiently large
-    constexpr double kick_cost = 3;       // Must be less than big_num
-    constexpr double p_weight = 1. / 3.;  // Such that >6 terms (2 years) flattens
+// Cost of assigning a person, who made n choices, to their i'th choice
+inline double choice_cost(std::size_t i,
+                          std::size_t n,
+                          std::size_t priority,
+                          bool hostel,
+                          double bias_fist,
+                          double p_weight,
+                          double hostel_penalty) {
+    // For scaling inverse hyperbolic tangent
+    double coef = atanh(bias_fist) / (std::max(1ul, n - 1));
+    // Bias hostel choices
+    double non_hostel_penalty = hostel ? 0.0 : hostel_penalty * std::tanh(priority * p_weight);
+
+    // Cost of assigning person to room they DO want.  Ensure: 0 < cost <= Kick_cost
+    return std::tanh(i * coef) / bias_fist + non_hostel_penalty;
+}
+
+/*
+ *  Constants of the cost model as compile-time parameters, the defaults are those used by the
+ *  ballot. Any policy must provide the same static members.
+ */
+template <double BiasFirst = 0.95,
+          double BigNum = 100.,
+          double KickCost = 3.,
+          double PWeight = 1. / 3.,
+          double HostelPenalty = 2.>
+struct CostPolicy {
+    static constexpr double bias_fist = BiasFirst;  // In (0,1)
+    static constexpr double big_num = BigNum;       // Sufficiently large
+    static constexpr double kick_cost = KickCost;   // Must be less than big_num
+    static constexpr double p_weight = PWeight;     // Such that >6 terms (2 years) flattens
+
+    // Scale of the penalty for allocating non-hostel rooms
+    static constexpr double hostel_penalty = HostelPenalty;
+
+    static_assert(0 < bias_fist && bias_fist < 1);
+    static_assert(kick_cost < big_num);
+
+    static double choice(std::size_t i, std::size_t n, std::size_t priority, bool hostel) {
+        return choice_cost(i, n, priority, hostel, bias_fist, p_weight, hostel_penalty);
+    }
+};
+
+using DefaultCost = CostPolicy<>;
+
+// The constants of a policy as run-time values (e.g. for sweeps), validated on construction
+class CostParams {
+  public:
+    template <typename Policy = DefaultCost> static CostParams of() {
+        return {Policy::bias_fist,
+                Policy::big_num,
+                Policy::kick_cost,
+                Policy::p_weight,
+                Policy::hostel_penalty};
+    }
+
+    CostParams(double bias_fist,
+               double big_num,
+               double kick_cost,
+               double p_weight,
+               double hostel_penalty)
+        : bias_fist(bias_fist),
+          big_num(big_num),
+          kick_cost(kick_cost),
+          p_weight(p_weight),
+          hostel_penalty(hostel_penalty) {
+        if (!(0 < bias_fist && bias_fist < 1)) {
+            throw std::invalid_argument("bias_fist must be in (0,1)");
+        }
+        if (!(kick_cost < big_num)) {
+            throw std::invalid_argument("kick_cost must be less than big_num");
+        }
+    }
+
+    double bias_fist;
+    double big_num;
+    double kick_cost;
+    double p_weight;
+    double hostel_penalty;
 
+    [[nodiscard]] double choice(std::size_t i,
+                                std::size_t n,
+                                std::size_t priority,
+                                bool hostel) const {
+        return choice_cost(i, n, priority, hostel, bias_fist, p_weight, hostel_penalty);
+    }
+};
+
+// Cost function - overall cost is minimised
+template <typename F, typename Policy = DefaultCost>
+double cost_function(Person const& p, Room const& r, F&& is_hostel, Policy = {}) {
     /*  */ if (p && r) {
         if (std::optional i = p->choice_index(*r)) {
-            // For scaling inverse hyperbolic tangent
-            double coef = atanh(bias_fist) / (std::max(1ul, p->pref.size() - 1));
-            // Bias hostel choices
-            double non_hostel_penalty = is_hostel(r) ? 0.0 : 2 * std::tanh(p->priority * p_weight);
-
-            // Cost of assigning person to room they DO want.  Ensure: 0 < cost <= Kick_cost
-            return std::tanh(*i * coef) / bias_fist + non_hostel_penalty;
+            return Policy::choice(*i, p->pref.size(), p->priority, is_hostel(r));
         } else {
             // Cost of assigning person to room they DO-NOT want, justification:
             //     Bigger than the maximum expected number of players such that it never occurs.
-            return big_num;
+            return Policy::big_num;
         }
     } else if (p && !r) {
         // Justification:
@@ -43,11 +128,158 @@ template <typename F> double cost_function(Person const& p, Room const& r, F&& i
         //     Kicking off ballot should be as close to the cost of getting last choice as this
         //     disincentivises people choosing lots of honey-pot rooms however, this conflicts
         //     with desire to reduce kicking.
-        return kick_cost;
+        return Policy::kick_cost;
     } else {
         // Justification:
         //     Agnostic of room/kicked -> value irrelevant, therefore zero to keep total score
         //     small.
         return 0;
     }
-}
\ No newline at end of file
+}
+
+/*
+ *  Fixed-point costs for the integer mode. Costs are rounded to the nearest multiple of 2^-20, as
+ *  the grid is a power of two the rounded costs (and sums of fewer than 2^33 of them) are exact in
+ *  a double. Hence, given the same rounded table, each backend does exact arithmetic and makes the
+ *  same choices on any compiler or platform. The dense and sparse backends solve in int32_t units
+ *  of 2^-20, summed in 64 bits.
+ *
+ *  What rounding does not guarantee:
+ *   - The same rounded table everywhere. The costs come from libm's tanh/atanh, which may differ by
+ *     an ulp between platforms, moving a cost within an ulp of a rounding boundary by 2^-20.
+ *   - The same order of allocations. Rounding is monotone so two single costs keep their order or
+ *     tie, but each of the n costs of an allocation moves by up to 2^-21, so allocations whose
+ *     totals differ by less than n * 2^-20 can swap. The solution (and its certificate) is optimal
+ *     for the rounded costs, its exact total is within n * 2^-20 of the exact optimum.
+ */
+inline constexpr int fixed_bits = 20;
+inline constexpr double fixed_scale = 1 << fixed_bits;
+
+// Largest cost allowed in the integer mode, leaves headroom for the potentials and distances
+inline constexpr double fixed_max = std::numeric_limits<std::int32_t>::max() / 4 / fixed_scale;
+
+// Round a cost to the fixed-point grid
+inline double quantise(double x) { return std::round(x * fixed_scale) / fixed_scale; }
+
+// A (quantised) cost in the units of T, 2^-20 for integers
+template <typename T> T to_units(double x) {
+    if constexpr (std::is_integral_v<T>) {
+        return static_cast<T>(std::lround(x * fixed_scale));
+    } else {
+        return x;
+    }
+}
+
+// Inverse of to_units
+template <typename T> double from_units(T x) {
+    if constexpr (std::is_integral_v<T>) {
+        return x / fixed_scale;
+    } else {
+        return x;
+    }
+}
+
+/*
+ *  The cost function tabulated for a cohort. The cost of a person taking one of their choices only
+ *  depends on (number of choices, priority, rank, hostel) hence each distinct (number of choices,
+ *  priority) pair gets a row of the table indexed by (rank, hostel). Entries are computed by the
+ *  policy exactly as cost_function would, so results are bit-identical.
+ */
+class CostTable {
+  public:
+    template <typename Policy = DefaultCost>
+    explicit CostTable(Cohort const& c, Policy = {}) : CostTable(c, CostParams::of<Policy>()) {}
+
+    CostTable(Cohort const& c, CostParams const& params)
+        : m_big_num(params.big_num), m_kick_cost(params.kick_cost) {
+        std::map<std::pair<std::size_t, std::size_t>, std::size_t> rows;
+
+        for (std::size_t i = 0; i < c.num_people(); i++) {
+            auto [it, inserted] = rows.try_emplace({c.n_pref[i], c.priority[i]}, m_table.size());
+
+            if (inserted) {
+                for (std::size_t rank = 0; rank < c.n_pref[i]; rank++) {
+                    m_table.push_back(params.choice(rank, c.n_pref[i], c.priority[i], false));
+                    m_table.push_back(params.choice(rank, c.n_pref[i], c.priority[i], true));
+                }
+            }
+
+            m_row.push_back(it->second);
+        }
+    }
+
+    // Table for a subset of the people, person i of the result is people[i]
+    [[nodiscard]] CostTable select(std::vector<std::uint32_t> const& people) const {
+        CostTable t{*this};
+
+        t.m_row.clear();
+
+        for (std::uint32_t i : people) {
+            t.m_row.push_back(m_row[i]);
+        }
+
+        return t;
+    }
+
+    // Copy with every cost rounded to the fixed-point grid, see quantise
+    [[nodiscard]] CostTable quantised() const {
+        auto fixed = [](double x) {
+            if (!(std::abs(x) <= fixed_max)) {
+                throw std::invalid_argument("Costs are too large for the integer mode");
+            }
+            return quantise(x);
+        };
+
+        CostTable t{*this};
+
+        t.m_big_num = fixed(m_big_num);
+        t.m_kick_cost = fixed(m_kick_cost);
+
+        for (double& x : t.m_table) {
+            x = fixed(x);
+        }
+
+        t.m_fixed = true;
+
+        return t;
+    }
+
+    // True if the costs are on the fixed-point grid, the backends then solve in integers
+    [[nodiscard]] bool fixed_point() const { return m_fixed; }
+
+    // Cost of person taking their choice of the given rank
+    [[nodiscard]] double choice(std::size_t person, std::uint32_t rank, bool hostel) const {
+        return m_table[m_row[person] + 2 * rank + hostel];
+    }
+
+    // Cost of assigning a person to a room they did not choose
+    [[nodiscard]] double big_num() const { return m_big_num; }
+
+    // Cost of kicking a person off the ballot
+    [[nodiscard]] double kick_cost() const { return m_kick_cost; }
+
+    // Interned equivalent of cost_function, p/r are ids (nullopt for null person/room)
+    [[nodiscard]] double operator()(Cohort const& c,
+                                    std::optional<std::uint32_t> p,
+                                    std::optional<std::uint32_t> r) const {
+        /*  */ if (p && r) {
+            if (std::optional i = c.choice_index(*p, *r)) {
+                return choice(*p, *i, c.hostel[*r]);
+            } else {
+                return m_big_num;
+            }
+        } else if (p && !r) {
+            return m_kick_cost;
+        } else {
+            return 0;
+        }
+    }
+
+  private:
+    double m_big_num;
+    double m_kick_cost;
+    bool m_fixed = false;
+
+    std::vector<double> m_table{};
+    std::vector<std::size_t> m_row{};  // Person -> offset of their row in m_table
+};
@@ -0,0 +1,111 @@
+// Copyright (C) 2020 Conor Williams
+
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include "explain.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <ostream>
+#include <vector>
+
+#include "cohort.hpp"
+#include "cost.hpp"
+#include "parallel.hpp"
+#include "solve.hpp"
+
+namespace {  // Like static
+
+// Rank of the room allocated to person i, in their own choices
+std::optional<std::uint32_t> rank_of(Cohort const& c, std::size_t i, Allocation const& a) {
+    return a[i] ? c.choice_index(i, *a[i]) : std::nullopt;
+}
+
+void write_rank(std::ostream& out, std::optional<std::uint32_t> rank) {
+    if (rank) {
+        out << ',' << *rank + 1;
+    } else {
+        out << ",kicked";
+    }
+}
+
+}  // namespace
+
+std::vector<Explanation> explain(Cohort const& c,
+                                 CostTable const& t,
+                                 CostParams const& params,
+                                 Solution const& sol,
+                                 std::size_t threads) {
+    std::vector<Explanation> out(c.num_people());
+
+    parallel_for(c.num_people(), threads, [&](std::size_t begin, std::size_t end) {
+        RowUpdate update{c, t, sol};
+
+        for (std::size_t i = begin; i < end; i++) {
+            Explanation& x = out[i];
+
+            x.rank = rank_of(c, i, sol.allocation);
+
+            std::vector<double> costs(c.n_pref[i], t.big_num());
+
+            // Room of each rank, people who listed a room twice keep the first
+            std::vector<std::optional<std::uint32_t>> room(c.n_pref[i]);
+
+            for (std::size_t e = c.row_start[i]; e < c.row_start[i + 1]; e++) {
+                room[c.rank[e]] = c.room[e];
+            }
+
+            if (c.priority[i] == 1) {
+                x.priority_1 = x.rank;
+            } else {
+                for (std::uint32_t k = 0; k < c.n_pref[i]; k++) {
+                    bool const hostel = room[k] && c.hostel[*room[k]];
+                    double const cost = params.choice(k, c.n_pref[i], 1, hostel);
+                    costs[k] = t.fixed_point() ? quantise(cost) : cost;
+                }
+
+                x.priority_1 = rank_of(c, i, update.update(i, costs));
+            }
+
+            if (c.n_pref[i] < 2) {
+                x.swapped = x.rank;
+            } else {
+                for (std::uint32_t k = 0; k < c.n_pref[i]; k++) {
+                    std::uint32_t const as = k < 2 ? 1 - k : k;
+                    costs[k] = t.choice(i, as, room[k] && c.hostel[*room[k]]);
+                }
+
+                x.swapped = rank_of(c, i, update.update(i, costs));
+            }
+
+            // Withdrawn, no choice is better than being kicked
+            std::fill(costs.begin(), costs.end(), t.big_num());
+
+            Allocation const without = update.update(i, costs);
+
+            for (std::size_t j = 0; j < c.num_people(); j++) {
+                x.moved += j != i && without[j] != sol.allocation[j];
+            }
+        }
+    });
+
+    return out;
+}
+
+void write_explanations(std::ostream& out,
+                        std::vector<std::size_t> const& index,
+                        std::vector<Explanation> const& rows) {
+    out << "index,choice,priority_1,swapped,withdraw_moved\n";
+
+    for (std::size_t i = 0; i < rows.size(); i++) {
+        out << index[i];
+        write_rank(out, rows[i].rank);
+        write_rank(out, rows[i].priority_1);
+        write_rank(out, rows[i].swapped);
+        out << ',' << rows[i].moved << '\n';
+    }
+}
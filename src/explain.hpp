@@ -0,0 +1,44 @@
+// Copyright (C) 2020 Conor Williams
+
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <ostream>
+#include <vector>
+
+#include "cohort.hpp"
+#include "cost.hpp"
+#include "solve.hpp"
+
+// What one person got, and would have got, in an optimal allocation. Ranks are 0 for a first
+// choice and nullopt if kicked.
+struct Explanation {
+    std::optional<std::uint32_t> rank{};        // In the solution
+    std::optional<std::uint32_t> priority_1{};  // Had they had priority 1
+    std::optional<std::uint32_t> swapped{};     // Had they swapped their first two choices
+    std::size_t moved = 0;                      // Others whose room changes if they withdraw
+};
+
+/*
+ *  Counterfactuals for every person in the cohort, each a single person update (see RowUpdate) of
+ *  the optimal solution, concurrently on up to "threads" threads. The costs of priority 1 come from
+ *  params, rounded to the fixed-point grid if the table is. Where the optimum is not unique the
+ *  update may settle on a different one, hence people can be counted as moved by a withdrawal that
+ *  does not affect them.
+ */
+std::vector<Explanation> explain(Cohort const&,
+                                 CostTable const&,
+                                 CostParams const& params,
+                                 Solution const&,
+                                 std::size_t threads);
+
+// Csv with a header, one line per person, index[i] is the results index of person i
+void write_explanations(std::ostream&,
+                        std::vector<std::size_t> const& index,
+                        std::vector<Explanation> const&);
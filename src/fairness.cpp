@@ -0,0 +1,132 @@
+// Copyright (C) 2020 Conor Williams
+
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include "fairness.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "ballot.hpp"
+#include "cohort.hpp"
+#include "cost.hpp"
+#include "parallel.hpp"
+#include "solve.hpp"
+
+bool Outcomes::varies() const {
+    std::size_t kinds = (kicked > 0) + (missed > 0);
+
+    for (std::size_t n : by_choice) {
+        kinds += n > 0;
+    }
+
+    return kinds > 1;
+}
+
+std::vector<Outcomes> fairness(Cohort const& c,
+                               CostTable const& t,
+                               std::size_t orders,
+                               std::function<std::vector<std::size_t>(std::size_t)> const& order,
+                               std::optional<std::size_t> max_rooms,
+                               Solver solver,
+                               std::size_t threads) {
+    std::vector<Outcomes> out(c.num_people());
+
+    for (std::size_t i = 0; i < c.num_people(); i++) {
+        out[i].by_choice.resize(c.n_pref[i]);
+    }
+
+    std::mutex mutex;
+
+    parallel_tasks(orders, threads, [&](std::size_t k) {
+        std::vector<std::uint32_t> people;
+
+        for (std::size_t i : order(k)) {
+            people.push_back(i);
+        }
+
+        std::stable_sort(people.begin(), people.end(), [&](std::uint32_t a, std::uint32_t b) {
+            return c.priority[a] < c.priority[b];
+        });
+
+        std::size_t const kept = max_rooms ? std::min(*max_rooms, people.size()) : people.size();
+
+        std::vector<std::uint32_t> const missed(people.begin() + kept, people.end());
+
+        people.resize(kept);
+
+        // Only the rooms the kept people chose, as find_rooms would
+        std::vector<bool> chosen(c.num_rooms(), false);
+
+        for (std::uint32_t i : people) {
+            for (std::size_t e = c.row_start[i]; e < c.row_start[i + 1]; e++) {
+                chosen[c.room[e]] = true;
+            }
+        }
+
+        std::vector<std::uint32_t> rooms;
+
+        for (std::uint32_t r = 0; r < c.num_rooms(); r++) {
+            if (chosen[r]) {
+                rooms.push_back(r);
+            }
+        }
+
+        Solution const sol = solve(sub_cohort(c, people, rooms), t.select(people), {solver, 1});
+
+        std::lock_guard lock{mutex};
+
+        for (std::size_t i = 0; i < people.size(); i++) {
+            if (std::optional r = sol.allocation[i]) {
+                out[people[i]].by_choice[*c.choice_index(people[i], rooms[*r])] += 1;
+            } else {
+                out[people[i]].kicked += 1;
+            }
+        }
+
+        for (std::uint32_t i : missed) {
+            out[i].missed += 1;
+        }
+    });
+
+    return out;
+}
+
+void write_fairness(std::ostream& out,
+                    std::vector<std::string_view> const& names,
+                    std::vector<std::size_t> const& priority,
+                    std::vector<Outcomes> const& rows) {
+    std::size_t max_pref = 0;
+
+    for (auto&& row : rows) {
+        max_pref = std::max(max_pref, row.by_choice.size());
+    }
+
+    out << "name,priority";
+
+    for (std::size_t i = 0; i < max_pref; i++) {
+        out << ",choice_" << i + 1;
+    }
+
+    out << ",kicked,missed\n";
+
+    for (std::size_t i = 0; i < rows.size(); i++) {
+        out << names[i] << ',' << priority[i];
+
+        for (std::size_t k = 0; k < max_pref; k++) {
+            out << ',' << (k < rows[i].by_choice.size() ? rows[i].by_choice[k] : 0);
+        }
+
+        out << ',' << rows[i].kicked << ',' << rows[i].missed << '\n';
+    }
+}
@@ -0,0 +1,51 @@
+// Copyright (C) 2020 Conor Williams
+
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "ballot.hpp"
+#include "cohort.hpp"
+#include "cost.hpp"
+
+// How many of the orders gave a person each outcome
+struct Outcomes {
+    std::vector<std::size_t> by_choice{};  // Choice index -> number of times allocated it
+    std::size_t kicked = 0;                // By the solver
+    std::size_t missed = 0;                // Trimmed by max_rooms
+
+    // True if not every order gave the same outcome
+    [[nodiscard]] bool varies() const;
+};
+
+/*
+ *  Re-run the ballot of the cohort under each of "orders" orders of its people, concurrently on up
+ *  to "threads" threads (one solve per thread). order(k) lists the person ids in the k'th order and
+ *  may be called concurrently. As in run, the people are then stably sorted by priority and only
+ *  the first max_rooms kept. The kept people and the rooms they chose are solved as a sub-cohort,
+ *  sharing the symbols of the cohort and the costs of the table. Returns the outcomes of each
+ *  person of the cohort, which do not depend on the number of threads.
+ */
+std::vector<Outcomes> fairness(Cohort const&,
+                               CostTable const&,
+                               std::size_t orders,
+                               std::function<std::vector<std::size_t>(std::size_t)> const& order,
+                               std::optional<std::size_t> max_rooms,
+                               Solver solver,
+                               std::size_t threads);
+
+// Csv with a header, one line per person
+void write_fairness(std::ostream&,
+                    std::vector<std::string_view> const& names,
+                    std::vector<std::size_t> const& priority,
+                    std::vector<Outcomes> const&);
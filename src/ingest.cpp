@@ -0,0 +1,180 @@
+// Copyright (C) 2020 Conor Williams
+
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include "ingest.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <cstddef>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+namespace {  // Like static
+
+std::string_view trim(std::string_view cell) {
+    constexpr std::string_view space = " \r\n";
+
+    std::size_t first = cell.find_first_not_of(space);
+
+    if (first == std::string_view::npos) {
+        return {};
+    }
+
+    return cell.substr(first, cell.find_last_not_of(space) - first + 1);
+}
+
+std::string_view unquote(std::string_view cell) {
+    if (cell.size() >= 2 && cell.front() == '"' && cell.back() == '"') {
+        return trim(cell.substr(1, cell.size() - 2));
+    }
+    return cell;
+}
+
+// Split the next cell off the front of a line, delimiters inside quotes are ignored. Sets more if a
+// delimiter followed the cell, hence another (possibly empty) cell follows.
+std::string_view next_cell(std::string_view& line, bool& more) {
+    bool quoted = false;
+
+    std::size_t end = 0;
+
+    for (; end < line.size(); end++) {
+        if (line[end] == '"') {
+            quoted = !quoted;
+        } else if (line[end] == ',' && !quoted) {
+            break;
+        }
+    }
+
+    std::string_view cell = line.substr(0, end);
+
+    more = end < line.size();
+
+    line.remove_prefix(std::min(end + 1, line.size()));
+
+    return unquote(trim(cell));
+}
+
+// Call f(row, line) for each non-blank line of text, rows count from one
+template <typename F> void for_each_line(std::string_view text, F&& f) {
+    for (std::size_t row = 1; !text.empty(); row++) {
+        std::size_t eol = text.find('\n');
+
+        std::string_view const line = text.substr(0, eol);
+
+        text.remove_prefix(eol == std::string_view::npos ? text.size() : eol + 1);
+
+        if (!trim(line).empty()) {
+            f(row, line);
+        }
+    }
+}
+
+// The whole of a file
+std::unique_ptr<char[]> read_file(std::string const& fname, std::size_t& size) {
+    std::ifstream file(fname, std::ios::binary | std::ios::ate);
+
+    if (!file) {
+        throw std::runtime_error("Could not open " + fname);
+    }
+
+    size = file.tellg();
+
+    auto text = std::make_unique<char[]>(size);
+
+    file.seekg(0);
+
+    if (!file.read(text.get(), size)) {
+        throw std::runtime_error("Could not read " + fname);
+    }
+
+    return text;
+}
+
+}  // namespace
+
+std::size_t parse_size(std::string_view cell, std::string const& what, std::size_t row) {
+    std::size_t x = 0;
+
+    auto [ptr, ec] = std::from_chars(cell.data(), cell.data() + cell.size(), x);
+
+    if (ec != std::errc{} || ptr != cell.data() + cell.size() || cell.empty()) {
+        throw std::runtime_error("Invalid " + what + " on line " + std::to_string(row));
+    }
+
+    return x;
+}
+
+CsvLines::CsvLines(std::string const& fname) {
+    m_text = read_file(fname, m_size);
+
+    for_each_line({m_text.get(), m_size}, [&](std::size_t row, std::string_view line) {
+        Line& l = m_lines.emplace_back(Line{row, {}});
+
+        for (bool more = true; more;) {
+            l.cells.push_back(next_cell(line, more));
+        }
+    });
+}
+
+PeopleCsv::PeopleCsv(std::string const& fname) {
+    m_text = read_file(fname, m_size);
+    parse();
+}
+
+PeopleCsv::PeopleCsv(char const* text, std::size_t size)
+    : m_text(std::make_unique<char[]>(size)), m_size(size) {
+    std::copy(text, text + size, m_text.get());
+    parse();
+}
+
+void PeopleCsv::parse() {
+    std::string_view text{m_text.get(), m_size};
+
+    // Size the arrays from the first row and the number of lines
+    std::size_t const lines = std::count(text.begin(), text.end(), '\n') + 1;
+
+    for_each_line(text, [&](std::size_t row, std::string_view line) {
+        bool more = false;
+
+        std::string_view const name = next_cell(line, more);
+        std::string_view const crsid = next_cell(line, more);
+        std::size_t const p = parse_size(next_cell(line, more), "priority", row);
+
+        std::size_t const before = m_pref.size();
+
+        while (more) {
+            std::string_view const choice = next_cell(line, more);
+
+            if (choice.empty()) {
+                throw std::runtime_error("Empty choice on line " + std::to_string(row)
+                                         + ", maybe a trailing comma");
+            }
+
+            m_pref.push_back(choice);
+        }
+
+        if (m_priority.empty()) {
+            m_choices = m_pref.size();
+
+            m_name.reserve(lines);
+            m_crsid.reserve(lines);
+            m_priority.reserve(lines);
+            m_pref.reserve(lines * m_choices);
+        } else if (m_pref.size() - before != m_choices) {
+            throw std::runtime_error("Not all people have made the same number of choices, line "
+                                     + std::to_string(row));
+        }
+
+        m_name.push_back(name);
+        m_crsid.push_back(crsid);
+        m_priority.push_back(p);
+    });
+}
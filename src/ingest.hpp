@@ -0,0 +1,86 @@
+// Copyright (C) 2020 Conor Williams
+
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Parse a whole cell as a non-negative integer, throws "Invalid <what> on line <row>" otherwise
+std::size_t parse_size(std::string_view cell, std::string const& what, std::size_t row);
+
+/*
+ *  The non-blank lines of a csv split into cells, by the same rules as PeopleCsv (trimmed, maybe
+ *  quoted) but with any number of cells per line, empty ones included. For the small csvs:
+ *  capacities, verification pairs, secret ballots and deltas.
+ */
+class CsvLines {
+  public:
+    explicit CsvLines(std::string const& fname);
+
+    struct Line {
+        std::size_t row;                      // Line number from one, for errors
+        std::vector<std::string_view> cells;  // Views into the text
+    };
+
+    [[nodiscard]] auto begin() const { return m_lines.begin(); }
+
+    [[nodiscard]] auto end() const { return m_lines.end(); }
+
+  private:
+    std::unique_ptr<char[]> m_text{};
+    std::size_t m_size = 0;
+
+    std::vector<Line> m_lines{};
+};
+
+/*
+ *  A ballot csv (columns: name, crsid, priority, choice 1, ..., choice n) read in one go into a
+ *  single buffer. Every cell is a view into the buffer and the choices of all people are stored
+ *  contiguously, hence loading allocates a handful of times regardless of the number of rows.
+ *
+ *  Cells are trimmed of ' ', '\r' and '\n' and may be quoted to contain commas, the quotes are
+ *  removed. Blank lines are skipped, empty choices (e.g. after a trailing comma) are an error.
+ */
+class PeopleCsv {
+  public:
+    explicit PeopleCsv(std::string const& fname);
+
+    // Parse text already in memory
+    PeopleCsv(char const* text, std::size_t size);
+
+    [[nodiscard]] std::size_t size() const { return m_priority.size(); }
+
+    // Number of choices every person made
+    [[nodiscard]] std::size_t choices() const { return m_choices; }
+
+    [[nodiscard]] std::string_view name(std::size_t i) const { return m_name[i]; }
+
+    [[nodiscard]] std::string_view crsid(std::size_t i) const { return m_crsid[i]; }
+
+    [[nodiscard]] std::size_t priority(std::size_t i) const { return m_priority[i]; }
+
+    [[nodiscard]] std::span<std::string_view const> pref(std::size_t i) const {
+        return {m_pref.data() + i * m_choices, m_choices};
+    }
+
+  private:
+    void parse();
+
+    std::unique_ptr<char[]> m_text{};
+    std::size_t m_size = 0;
+
+    std::size_t m_choices = 0;
+
+    std::vector<std::string_view> m_name{};
+    std::vector<std::string_view> m_crsid{};
+    std::vector<std::size_t> m_priority{};
+    std::vector<std::string_view> m_pref{};  // Person i's are [i * choices, (i + 1) * choices)
+};
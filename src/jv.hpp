@@ -0,0 +1,234 @@
+// Copyright (C) 2020 Conor Williams
+
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+#include "lapjv.hpp"
+#include "parallel.hpp"
+#include "simd.hpp"
+
+/*
+ *  A port of lap(), Jonker & Volgenant's algorithm for the square problem in the arena: column
+ *  reduction, two rounds of augmenting row reduction then a shortest augmenting path for each
+ *  remaining free row. It follows the original step for step, with the same comparisons in the
+ *  same order, hence makes the same choices and returns the same solution. The contiguous scans of
+ *  rows are vectorised (see simd.hpp) and the column reduction, the only pass over the whole
+ *  matrix, is split into blocks of columns on up to "threads" threads. The shortest path searches
+ *  visit the columns through a permutation, gathering them measured slower than scalar loads so
+ *  they are left as in lap(). Costs may be double or int32_t.
+ */
+template <typename T> lap_sum<T> lap_jv(int dim, BasicLapArena<T> &arena, std::size_t threads = 1) {
+    static_assert(std::is_same_v<T, double> || std::is_same_v<T, std::int32_t>);
+
+    // As lap()'s BIG, larger than any reduced cost (integer costs are under a quarter of the range)
+    T const big = [] {
+        if constexpr (std::is_integral_v<T>) {
+            return std::numeric_limits<T>::max() / 4;
+        } else {
+            return 100000000.0;
+        }
+    }();
+
+    T **c = arena.rows();
+    col *rowsol = arena.rowsol();
+    row *colsol = arena.colsol();
+    T *u = arena.u();
+    T *v = arena.v();
+
+    std::vector<row> free(dim);
+    std::vector<col> collist(dim);
+    std::vector<int> matches(dim, 0);
+    std::vector<T> d(dim);
+    std::vector<row> pred(dim);
+    std::vector<row> imin(dim, 0);
+
+    // Column reduction, the lowest row of the minima of each column
+    parallel_for(dim, threads, [&](std::size_t begin, std::size_t end) {
+        std::copy(c[0] + begin, c[0] + end, v + begin);
+
+        for (row i = 1; i < dim; i++) {
+            simd::column_min(c[i] + begin, end - begin, i, v + begin, imin.data() + begin);
+        }
+    });
+
+    for (col j = dim; j--;) {
+        if (++matches[imin[j]] == 1) {
+            rowsol[imin[j]] = j;
+            colsol[j] = imin[j];
+        } else {
+            colsol[j] = -1;
+        }
+    }
+
+    // Reduction transfer
+    int numfree = 0;
+
+    for (row i = 0; i < dim; i++) {
+        if (matches[i] == 0) {
+            free[numfree++] = i;
+        } else if (matches[i] == 1) {
+            col const j1 = rowsol[i];
+            simd::Top2<T> const t = simd::top2(c[i], v, dim, big);
+
+            // Smallest reduced cost of the other columns
+            v[j1] = v[j1] - std::min(t.j1 != j1 ? t.m1 : t.m2, big);
+        }
+    }
+
+    // Augmenting row reduction, twice
+    for (int loop = 0; loop < 2; loop++) {
+        int const prvnumfree = numfree;
+        int k = 0;
+
+        numfree = 0;
+
+        while (k < prvnumfree) {
+            row const i = free[k++];
+
+            auto [umin, j1, usubmin, j2] = simd::top2(c[i], v, dim, big);
+
+            row i0 = colsol[j1];
+
+            if (umin < usubmin) {
+                v[j1] = v[j1] - (usubmin - umin);
+            } else if (i0 > -1) {
+                j1 = j2;
+                i0 = colsol[j2];
+            }
+
+            rowsol[i] = j1;
+            colsol[j1] = i;
+
+            if (i0 > -1) {
+                if (umin < usubmin) {
+                    free[--k] = i0;
+                } else {
+                    free[numfree++] = i0;
+                }
+            }
+        }
+    }
+
+    arena.scans() = 0;
+
+    // Augment the remaining free rows
+    for (int f = 0; f < numfree; f++) {
+        row const freerow = free[f];
+
+        for (col j = dim; j--;) {
+            d[j] = c[freerow][j] - v[j];
+            pred[j] = freerow;
+            collist[j] = j;
+        }
+
+        // Columns [0, low) are scanned, [low, up) are at distance min and [up, dim) are further
+        int low = 0;
+        int up = 0;
+        int last = 0;
+        T min = 0;
+
+        col endofpath = 0;
+        bool unassignedfound = false;
+
+        do {
+            if (up == low) {
+                // Find the columns at the next smallest distance
+                last = low - 1;
+                min = d[collist[up++]];
+
+                for (int k = up; k < dim; k++) {
+                    col const j = collist[k];
+
+                    if (d[j] <= min) {
+                        if (d[j] < min) {
+                            up = low;
+                            min = d[j];
+                        }
+                        collist[k] = collist[up];
+                        collist[up++] = j;
+                    }
+                }
+
+                for (int k = low; k < up; k++) {
+                    if (colsol[collist[k]] < 0) {
+                        endofpath = collist[k];
+                        unassignedfound = true;
+                        break;
+                    }
+                }
+            }
+
+            if (!unassignedfound) {
+                // Scan a column at distance min, relaxing through the row assigned to it
+                col const j1 = collist[low++];
+                row const i = colsol[j1];
+                T const h = c[i][j1] - v[j1] - min;
+
+                for (int k = up; k < dim; k++) {
+                    col const j = collist[k];
+                    T const v2 = c[i][j] - v[j] - h;
+
+                    if (v2 < d[j]) {
+                        pred[j] = i;
+
+                        if (v2 == min) {
+                            if (colsol[j] < 0) {
+                                endofpath = j;
+                                unassignedfound = true;
+                                break;
+                            }
+                            collist[k] = collist[up];
+                            collist[up++] = j;
+                        }
+
+                        d[j] = v2;
+                    }
+                }
+            }
+        } while (!unassignedfound);
+
+        arena.scans() += last + 1;
+
+        // Update potentials of the scanned columns
+        for (int k = last + 1; k--;) {
+            col const j1 = collist[k];
+            v[j1] = v[j1] + d[j1] - min;
+        }
+
+        // Flip assignments along the path
+        for (row i = -1; i != freerow;) {
+            i = pred[endofpath];
+            colsol[endofpath] = i;
+            std::swap(endofpath, rowsol[i]);
+        }
+    }
+
+    lap_sum<T> sum = 0;
+
+    for (row i = 0; i < dim; i++) {
+        col const j = rowsol[i];
+        u[i] = c[i][j] - v[j];
+        sum += c[i][j];
+    }
+
+    return sum;
+}
+
+// As lap_rows but solved by lap_jv
+template <typename T, class Fill>
+std::enable_if_t<std::is_invocable_v<Fill, std::size_t, T *>, lap_sum<T>> lap_jv_rows(
+    int dim, Fill &&fill, BasicLapArena<T> &arena, std::size_t threads = 1) {
+    fill_rows(dim, dim, fill, arena, threads);
+
+    return lap_jv(dim, arena, threads);
+}
@@ -6,12 +6,248 @@
 
 #pragma once
 
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
 #include <functional>
+#include <memory>
+#include <new>
 #include <stdexcept>
 #include <type_traits>
 #include <vector>
 
 #include "lap.h"
+#include "parallel.hpp"
+
+/*
+ *  Reusable memory for linear_assignment. The cost matrix is a single cache-line aligned,
+ *  row-major buffer (each row padded to a whole number of cache lines) with row pointers into it
+ *  for lap(), plus the work space of lap_rect's searches. Buffers only ever grow, hence repeated
+ *  solves of similar size do not allocate. Only lap_rect supports costs (and potentials) of type T
+ *  other than lap()'s cost, e.g. int32_t which halves the size of the matrix.
+ */
+template <typename T = cost> class BasicLapArena {
+  public:
+    static constexpr std::size_t alignment = 64;  // Bytes, one cache line
+
+    // Ensure capacity for a rows x cols problem and point the rows into the buffer
+    void reserve(int rows, int cols) {
+        std::size_t const per_line = alignment / sizeof(T);
+        std::size_t const stride = (cols + per_line - 1) / per_line * per_line;
+
+        if (stride * rows > m_capacity) {
+            m_buff.reset(static_cast<T *>(
+                ::operator new[](stride * rows * sizeof(T), std::align_val_t{alignment})));
+            m_capacity = stride * rows;
+        }
+
+        m_rows.resize(rows);
+
+        for (int i = 0; i < rows; i++) {
+            m_rows[i] = m_buff.get() + i * stride;
+        }
+
+        m_rowsol.resize(rows);
+        m_colsol.resize(cols);
+        m_u.resize(rows);
+        m_v.resize(cols);
+
+        m_d.resize(cols);
+        m_pred.resize(cols);
+        m_done.resize(cols);
+        m_scanned.reserve(cols);
+    }
+
+    void reserve(int dim) { reserve(dim, dim); }
+
+    T **rows() { return m_rows.data(); }
+    col *rowsol() { return m_rowsol.data(); }
+    row *colsol() { return m_colsol.data(); }
+    T *u() { return m_u.data(); }
+    T *v() { return m_v.data(); }
+
+    // Work space of lap_rect: distances, predecessors and scanned flags of the columns
+    T *d() { return m_d.data(); }
+    row *pred() { return m_pred.data(); }
+    char *done() { return m_done.data(); }
+    std::vector<col> &scanned() { return m_scanned; }
+
+    // Columns scanned by the searches of the last lap_rect, for profiling
+    std::size_t &scans() { return m_scans; }
+
+  private:
+    struct AlignedDelete {
+        void operator()(T *ptr) const { ::operator delete[](ptr, std::align_val_t{alignment}); }
+    };
+
+    std::unique_ptr<T[], AlignedDelete> m_buff{};
+    std::size_t m_capacity = 0;
+
+    std::vector<T *> m_rows{};
+    std::vector<col> m_rowsol{};
+    std::vector<row> m_colsol{};
+    std::vector<T> m_u{};
+    std::vector<T> m_v{};
+
+    std::vector<T> m_d{};
+    std::vector<row> m_pred{};
+    std::vector<char> m_done{};
+    std::vector<col> m_scanned{};
+
+    std::size_t m_scans = 0;
+};
+
+using LapArena = BasicLapArena<>;
+
+// Total cost of a solution, integer costs are summed in 64 bits
+template <typename T> using lap_sum = std::conditional_t<std::is_integral_v<T>, std::int64_t, T>;
+
+/*
+ *  Reserve a rows x cols problem in the arena and build its cost matrix. fill(i, row) must write
+ *  the cols costs of row i, it is called for blocks of rows on up to "threads" threads and must be
+ *  safe to call concurrently.
+ */
+template <typename T, class Fill>
+std::enable_if_t<std::is_invocable_v<Fill, std::size_t, T *>> fill_rows(
+    int rows, int cols, Fill &&fill, BasicLapArena<T> &arena, std::size_t threads = 1) {
+    arena.reserve(rows, cols);
+
+    T **cost_matrix = arena.rows();
+
+    parallel_for(rows, threads, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) {
+            std::invoke(fill, i, cost_matrix[i]);
+        }
+    });
+}
+
+/*
+ *  Lower level interface to lap() for callers that can build a whole row at once (e.g. from a
+ *  table). The cost matrix is built by fill_rows. Returns the total cost, the solution (rowsol,
+ *  colsol, u, v) is left in the arena.
+ */
+template <class Fill>
+std::enable_if_t<std::is_invocable_v<Fill, std::size_t, cost *>, double>
+lap_rows(int dim, Fill &&fill, LapArena &arena, std::size_t threads = 1) {
+    // Note that col, row, cost these types are typedef-ed in lap.h
+
+    fill_rows(dim, dim, fill, arena, threads);
+
+    // Use lap algorithm to calculate the minimum total cost
+    return lap(dim, arena.rows(), arena.rowsol(), arena.colsol(), arena.u(), arena.v());
+}
+
+/*
+ *  Shortest augmenting path solver for the rectangular (rows <= cols) problem in the arena, every
+ *  row is assigned to a distinct column and surplus columns are left unassigned, no padding is
+ *  built. Each row is inserted with one Dijkstra over the columns using the column potentials v.
+ *  On return v[j] <= 0 for all columns with v[j] == 0 for the unassigned ones, colsol[j] is -1 for
+ *  unassigned columns. Returns the total cost.
+ */
+template <typename T> lap_sum<T> lap_rect(int rows, int cols, BasicLapArena<T> &arena) {
+    if (rows > cols) {
+        throw std::invalid_argument("Requires rows <= cols");
+    }
+
+    T **c = arena.rows();
+    col *rowsol = arena.rowsol();
+    row *colsol = arena.colsol();
+    T *u = arena.u();
+    T *v = arena.v();
+
+    std::fill(rowsol, rowsol + rows, -1);
+    std::fill(colsol, colsol + cols, -1);
+    std::fill(v, v + cols, 0);
+
+    T *d = arena.d();
+    row *pred = arena.pred();
+    char *done = arena.done();
+    std::vector<col> &scanned = arena.scanned();
+
+    arena.scans() = 0;
+
+    for (row f = 0; f < rows; f++) {
+        for (col j = 0; j < cols; j++) {
+            d[j] = c[f][j] - v[j];
+            pred[j] = f;
+            done[j] = false;
+        }
+
+        scanned.clear();
+
+        col sink = -1;
+        T dmin = 0;
+
+        while (sink < 0) {
+            // Closest unscanned column, ties broken by lowest column
+            col j1 = -1;
+
+            for (col j = 0; j < cols; j++) {
+                if (!done[j] && (j1 < 0 || d[j] < d[j1])) {
+                    j1 = j;
+                }
+            }
+
+            done[j1] = true;
+            scanned.push_back(j1);
+
+            if (colsol[j1] < 0) {
+                sink = j1;
+                dmin = d[j1];
+            } else {
+                row i = colsol[j1];
+                T h = d[j1] - (c[i][j1] - v[j1]);
+
+                for (col j = 0; j < cols; j++) {
+                    if (!done[j] && h + c[i][j] - v[j] < d[j]) {
+                        d[j] = h + c[i][j] - v[j];
+                        pred[j] = i;
+                    }
+                }
+            }
+        }
+
+        arena.scans() += scanned.size();
+
+        // Update potentials of the columns that were closer than the sink
+        for (col j : scanned) {
+            v[j] += d[j] - dmin;
+        }
+
+        // Flip assignments along the path
+        for (col j = sink;;) {
+            row i = pred[j];
+            col prev = rowsol[i];
+
+            rowsol[i] = j;
+            colsol[j] = i;
+
+            if (i == f) {
+                break;
+            }
+
+            j = prev;
+        }
+    }
+
+    lap_sum<T> sum = 0;
+
+    for (row i = 0; i < rows; i++) {
+        u[i] = c[i][rowsol[i]] - v[rowsol[i]];
+        sum += c[i][rowsol[i]];
+    }
+
+    return sum;
+}
+
+// As lap_rows but for the rectangular (rows <= cols) problem solved by lap_rect
+template <typename T, class Fill>
+std::enable_if_t<std::is_invocable_v<Fill, std::size_t, T *>, lap_sum<T>> lap_rect_rows(
+    int rows, int cols, Fill &&fill, BasicLapArena<T> &arena, std::size_t threads = 1) {
+    fill_rows(rows, cols, fill, arena, threads);
+
+    return lap_rect(rows, cols, arena);
+}
 
 /*
  *  Provide type && memory safe interface to LAPJV linear assignment optimiser.
@@ -20,68 +256,107 @@
  *
  *      sum_i f(agent[i], task[i])
  *
- *  with f the supplied cost function.
+ *  with f the supplied cost function. The problem may be unbalanced: surplus tasks end up (in their
+ *  original order) after the first agents.size() tasks, surplus agents are given a value
+ *  initialised Task{} (e.g. std::nullopt). The balanced case uses lap(), otherwise lap_rect().
+ *
+ *  All memory is drawn from the supplied arena. The cost matrix is built by blocks of rows on up to
+ *  "threads" threads, f must be safe to call concurrently. Each cell is a single call to f hence
+ *  the matrix does not depend on the number of threads.
  */
 template <class Agent, class Task, class Cost>
 std::enable_if_t<std::is_invocable_r_v<double, Cost, Agent const &, Task const &>, double>
-linear_assignment(std::vector<Agent> const &agents, std::vector<Task> &tasks, Cost &&f) {
-    // Balanced assignment
-    if (agents.size() != tasks.size()) {
-        throw std::invalid_argument("Requires same number of agents and task");
-    }
+linear_assignment(std::vector<Agent> const &agents,
+                  std::vector<Task> &tasks,
+                  Cost &&f,
+                  LapArena &arena,
+                  std::size_t threads = 1) {
+    int const n = agents.size();
+    int const m = tasks.size();
 
-    // Decision to use c-style pointers as wrapping cost** with unique pointers is non-trivial
+    cost cost_sum = 0;
 
-    int dim = agents.size();
+    // Task assigned to each agent, -1 if none
+    std::vector<int> assigned(n, -1);
 
-    // Note that col, row, cost these types are typedef-ed in lap.h
+    if (n == m) {
+        // Balanced assignment
+        cost_sum = lap_rows(
+            n,
+            [&](std::size_t i, cost *row) {
+                for (int j = 0; j < m; ++j) {
+                    row[j] = std::invoke(f, agents[i], tasks[j]);
+                }
+            },
+            arena,
+            threads);
 
-    // Allocate array
-    cost **cost_matrix = [&] {
-        cost **tmp = new cost *[dim];
-        for (int i = 0; i < dim; i++) {
-            tmp[i] = new cost[dim];
-        }
-        return tmp;
-    }();
-
-    col *rowsol = new col[dim];
-    row *colsol = new row[dim];
-    cost *u = new cost[dim];
-    cost *v = new cost[dim];
-
-    // Assign costs to the cost_matrix
-    for (int i = 0; i < dim; ++i) {
-        for (int j = 0; j < dim; ++j) {
-            cost_matrix[i][j] = std::invoke(f, agents[i], tasks[j]);
+        std::copy(arena.rowsol(), arena.rowsol() + n, assigned.begin());
+    } else if (n < m) {
+        // Surplus tasks are left unassigned
+        cost_sum = lap_rect_rows(
+            n,
+            m,
+            [&](std::size_t i, cost *row) {
+                for (int j = 0; j < m; ++j) {
+                    row[j] = std::invoke(f, agents[i], tasks[j]);
+                }
+            },
+            arena,
+            threads);
+
+        std::copy(arena.rowsol(), arena.rowsol() + n, assigned.begin());
+    } else {
+        // Surplus agents, solve the transpose
+        cost_sum = lap_rect_rows(
+            m,
+            n,
+            [&](std::size_t j, cost *row) {
+                for (int i = 0; i < n; ++i) {
+                    row[i] = std::invoke(f, agents[i], tasks[j]);
+                }
+            },
+            arena,
+            threads);
+
+        for (int j = 0; j < m; j++) {
+            assigned[arena.rowsol()[j]] = j;
         }
     }
 
-    // Use lap algorithm to calculate the minimum total cost
-    cost cost_sum = lap(dim, cost_matrix, rowsol, colsol, u, v);
-
     {
-        // Reorder tasks
+        // Reorder tasks, assigned first then (if n < m) the unassigned in their original order
         std::vector<Task> ordered_tasks;
+        std::vector<bool> used(m, false);
 
-        for (int i = 0; i < dim; i++) {
-            ordered_tasks.push_back(std::move(tasks[rowsol[i]]));
+        ordered_tasks.reserve(std::max(n, m));
+
+        for (int i = 0; i < n; i++) {
+            if (assigned[i] >= 0) {
+                used[assigned[i]] = true;
+                ordered_tasks.push_back(std::move(tasks[assigned[i]]));
+            } else {
+                ordered_tasks.emplace_back();
+            }
+        }
+
+        for (int j = 0; j < m; j++) {
+            if (!used[j]) {
+                ordered_tasks.push_back(std::move(tasks[j]));
+            }
         }
 
         using std::swap;
         swap(ordered_tasks, tasks);
     }
 
-    // Release memory
-    for (int i = 0; i < dim; ++i) {
-        delete[] cost_matrix[i];
-    }
-    delete[] cost_matrix;
-
-    delete[] rowsol;
-    delete[] colsol;
-    delete[] u;
-    delete[] v;
-
     return cost_sum;
 }
+
+// As above with a temporary arena
+template <class Agent, class Task, class Cost>
+std::enable_if_t<std::is_invocable_r_v<double, Cost, Agent const &, Task const &>, double>
+linear_assignment(std::vector<Agent> const &agents, std::vector<Task> &tasks, Cost &&f) {
+    LapArena arena;
+    return linear_assignment(agents, tasks, std::forward<Cost>(f), arena);
+}
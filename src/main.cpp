@@ -4,45 +4,536 @@
 // License, v. 2.0. If a copy of the MPL was not distributed with this
 // file, You can obtain one at https://mozilla.org/MPL/2.0/.
 
+#include <algorithm>
 #include <cassert>
+#include <cmath>
+#include <cstdint>
 #include <fstream>
 #include <iostream>
+#include <map>
+#include <numeric>
 #include <optional>
+#include <stdexcept>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include "ballot.hpp"
-#include "cereal/archives/json.hpp"
-#include "cereal/types/optional.hpp"
-#include "cereal/types/vector.hpp"
+#include "cache.hpp"
+#include "certificate.hpp"
+#include "cohort.hpp"
 #include "collusion.hpp"
 #include "cost.hpp"
-#include "lapjv.hpp"
+#include "explain.hpp"
+#include "fairness.hpp"
+#include "profile.hpp"
+#include "public.hpp"
 #include "secrets.hpp"
+#include "solve.hpp"
+#include "sweep.hpp"
 
-std::vector<Person> load_people(Args& args) {
-    if (args.verify.has_value()) {
-        std::vector<Person> people{};
-        {
-            std::ifstream file(*args.verify.in_public);
-            cereal::JSONInputArchive archive(file);
-            archive(args.run.max_rooms, args.run.hostels, people);
-        }
-        return people;
+// Costs of a cohort, rounded to the fixed-point grid in the integer mode
+CostTable cost_table(Cohort const& c, bool integer) {
+    return integer ? CostTable{c}.quantised() : CostTable{c};
+}
+
+// File to write the profile of a run or verification to, if asked for
+std::optional<std::string> const& profile_name(Args const& args) {
+    return args.run.has_value() ? args.run.profile : args.verify.profile;
+}
+
+// End a phase of the profile, if there is one
+void lap(Profile* profile, std::string name) {
+    if (profile) {
+        profile->lap(std::move(name));
+    }
+}
+
+// People in anonymised order, when run also the csv they came from and the row of each
+std::vector<Person> load_people(Args& args,
+                                std::map<std::string, std::size_t>& capacities,
+                                Solution& certificate,
+                                bool& amended,
+                                std::optional<PeopleCsv>& csv,
+                                std::vector<std::size_t>& rows,
+                                Profile* profile) {
+    if (!args.run.has_value()) {
+        PublicBallot ballot = load_public(*args.verify.in_public);
+
+        args.run.max_rooms = ballot.max_rooms;
+        args.run.hostels = std::move(ballot.hostels);
+        args.run.solver = ballot.solver;
+        args.run.components = ballot.components;
+        args.run.presolve = ballot.presolve;
+        args.run.integer = ballot.integer;
+        capacities = std::move(ballot.capacities);
+        certificate = std::move(ballot.solution);
+        amended = ballot.amended;
+
+        lap(profile, "load");
+
+        return std::move(ballot.people);
     } else {
-        std::vector people = parse_people(args.run.in_people);
+        csv.emplace(read_people(args.run.in_people));
+
+        if (args.run.capacities) {
+            capacities = parse_capacities(*args.run.capacities);
+        }
 
-        anonymise_sort(people);
+        lap(profile, "parse");
+
+        // As anonymise_sort but the people are only built once, already in order
+        rows = shuffled_order(*csv, 0);
+
+        std::vector people = parse_people(*csv, rows);
+
+        for (auto&& p : people) {
+            anonymise(*p);
+        }
 
-        // Output for future verification
-        std::ofstream file(*args.run.out_public);
-        cereal::JSONOutputArchive archive(file);
-        archive(args.run.max_rooms, args.run.hostels, people);
+        lap(profile, "anonymise");
 
         return people;
     }
 }
 
+// Output for future verification, people in anonymised order. They are moved into the ballot and
+// back rather than copied.
+void save_public(Args const& args,
+                 std::vector<Person>& people,
+                 std::map<std::string, std::size_t> capacities,
+                 Solution solution) {
+    PublicBallot ballot;
+
+    ballot.max_rooms = args.run.max_rooms;
+    ballot.hostels = args.run.hostels;
+    ballot.people = std::move(people);
+    ballot.solver = *args.run.solver;
+    ballot.components = *args.run.components;
+    ballot.presolve = *args.run.presolve;
+    ballot.integer = *args.run.integer;
+    ballot.capacities = std::move(capacities);
+    ballot.solution = std::move(solution);
+
+    std::string const& fname = *args.run.out_public;
+
+    save_public(fname, ballot, public_format(fname, args.run.format));
+
+    people = std::move(ballot.people);
+}
+
+// Total cost of an allocation of the cohort, nullopt if it is not one (wrong size, unknown room or
+// over capacity)
+std::optional<double> total_cost(Cohort const& c, CostTable const& table, Allocation const& a) {
+    if (a.size() != c.num_people()) {
+        return std::nullopt;
+    }
+
+    std::vector<std::uint32_t> taken(c.num_rooms(), 0);
+
+    double sum = 0;
+
+    for (std::uint32_t i = 0; i < a.size(); i++) {
+        if (a[i] && (*a[i] >= c.num_rooms() || ++taken[*a[i]] > c.capacity[*a[i]])) {
+            return std::nullopt;
+        }
+
+        sum += table(c, i, a[i]);
+    }
+
+    return sum;
+}
+
+// Write the profile of a run or verification, if asked for
+void save_profile(Args const& args, Profile const* profile) {
+    if (profile) {
+        std::string const& fname = *profile_name(args);
+
+        std::ofstream out{fname};
+
+        if (!out) {
+            throw std::runtime_error("Could not open " + fname);
+        }
+
+        profile->write(out);
+
+        std::cout << "-- Wrote the profile to " << fname << '\n';
+    }
+}
+
+// Solve the ballot at every point of a grid of cost constants
+void sweep_costs(Args const& args) {
+    auto const& opt = args.sweep;
+
+    PeopleCsv const csv = read_people(opt.in_people);
+
+    std::map<std::string, std::size_t> capacities;
+
+    if (opt.capacities) {
+        capacities = parse_capacities(*opt.capacities);
+    }
+
+    // Same order and trimming as run, as rows of the csv
+    std::vector order = shuffled_order(csv, 0);
+
+    std::stable_sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) {
+        return csv.priority(a) < csv.priority(b);
+    });
+
+    std::vector<std::size_t> trimmed;
+
+    while (!order.empty() && opt.max_rooms && order.size() > *opt.max_rooms) {
+        trimmed.push_back(csv.priority(order.back()));
+        order.pop_back();
+    }
+
+    Cohort cohort = intern(csv, order, opt.hostels, capacities);
+
+    std::vector grid = cost_grid(opt.bias_fist, opt.kick_cost, opt.p_weight, opt.hostel_penalty);
+
+    std::cout << "-- Solving " << grid.size() << " combinations of the cost constants\n";
+
+    std::vector rows = sweep(cohort, trimmed, grid, *opt.solver, *opt.threads);
+
+    std::ofstream file(*opt.out);
+
+    write_sweep(file, rows);
+    write_sweep(std::cout, rows);
+}
+
+// Indices of people (in anonymised order) in the order of the results: those who missed the ballot
+// then the rest by priority, as in main. Sets kept to the number of the latter.
+std::vector<std::size_t> results_order(std::vector<Person> const& people,
+                                       std::optional<std::size_t> max_rooms,
+                                       std::size_t& kept) {
+    std::vector<std::size_t> sorted(people.size());
+
+    std::iota(sorted.begin(), sorted.end(), 0);
+
+    std::stable_sort(sorted.begin(), sorted.end(), [&](std::size_t a, std::size_t b) {
+        return people[a]->priority < people[b]->priority;
+    });
+
+    kept = max_rooms ? std::min(*max_rooms, sorted.size()) : sorted.size();
+
+    // Those who missed are popped off the back
+    std::vector<std::size_t> order(sorted.rbegin(), sorted.rend() - kept);
+
+    order.insert(order.end(), sorted.begin(), sorted.begin() + kept);
+
+    return order;
+}
+
+// The people who were allocated (or kicked by the solver) in a ballot
+std::vector<Person> cohort_people(std::vector<Person> const& people,
+                                  std::vector<std::size_t> const& order,
+                                  std::size_t kept) {
+    std::vector<Person> head;
+
+    for (std::size_t k = order.size() - kept; k < order.size(); k++) {
+        head.push_back(people[order[k]]);
+    }
+
+    return head;
+}
+
+// Print the analysis of the ballot for every max_rooms from first, the cohort is of the kept people
+// of the results order for max_rooms at the end of the range
+void sweep_max_rooms(Args const& args,
+                     std::size_t first,
+                     Cohort const& cohort,
+                     std::vector<Person> const& people,
+                     std::vector<std::size_t> const& order,
+                     Profile* profile) {
+    auto is_hostel = [&](Room const& room) -> bool {
+        return room && cohort.hostel[*cohort.room_id(*room)];
+    };
+
+    std::vector<std::pair<Person, Room>> results;
+
+    for (std::size_t k : order) {
+        results.emplace_back(people[k], std::nullopt);
+    }
+
+    std::size_t const missed = order.size() - cohort.num_people();
+
+    CostTable const table = cost_table(cohort, *args.run.integer);
+
+    lap(profile, "table");
+
+    std::size_t const last = cohort.num_people();
+
+    solve_prefixes(cohort, table, first, last, [&](std::size_t n, Allocation const& a) {
+        for (std::size_t i = 0; i < n; i++) {
+            results[missed + i].second = a[i] ? Room{cohort.rooms[*a[i]]} : std::nullopt;
+        }
+
+        std::cout << "\n-- With max_rooms = " << n << '\n';
+
+        analayse(results, is_hostel);
+    });
+
+    lap(profile, "sweep");
+}
+
+// Add/remove people from a ballot that has been run, repairing the optimum from its duals
+void amend_ballot(Args& args) {
+    auto const& opt = args.amend;
+
+    PublicBallot ballot = load_public(*opt.in_public);
+
+    std::vector<Person> people = std::move(ballot.people);
+
+    std::size_t kept = 0;
+
+    std::vector order = results_order(people, ballot.max_rooms, kept);
+
+    std::vector head = cohort_people(people, order, kept);
+
+    Cohort cohort = intern(head, find_rooms(head), ballot.hostels, ballot.capacities);
+
+    // The repair is only as good as the duals it starts from
+    check_certificate(cohort, cost_table(cohort, ballot.integer), ballot.solution);
+
+    // Restore the names, the one time pads prove the secret ballot matches
+    for (impl::Person& s : parse_secret(*opt.in_secret)) {
+        if (s.index >= order.size()) {
+            throw std::runtime_error("Secret ballot does not match the public ballot");
+        }
+
+        impl::Person& p = *people[order[s.index]];
+
+        s.name.resize(std::max(s.name.size(), p.secret_name.size()), ' ');
+
+        if (s.one_time_pad.size() != p.secret_name.size()
+            || string_xor(p.secret_name, s.one_time_pad) != s.name) {
+            throw std::runtime_error("Secret ballot does not match the public ballot");
+        }
+
+        p.name = std::move(s.name);
+        p.crsid = std::move(s.crsid);
+        p.one_time_pad = std::move(s.one_time_pad);
+    }
+
+    for (auto&& p : people) {
+        if (p->one_time_pad.empty()) {
+            throw std::runtime_error("Secret ballot is missing people");
+        }
+    }
+
+    // Previous room (or kick) of everyone in the cohort by name, nullopt for everyone else
+    std::vector<std::optional<Room>> previous(people.size());
+
+    for (std::size_t k = 0; k < kept; k++) {
+        std::optional r = ballot.solution.allocation[k];
+        previous[order[order.size() - kept + k]].emplace(r ? Room{cohort.rooms[*r]} : std::nullopt);
+    }
+
+    std::map<std::string, double> potential;
+
+    for (std::size_t r = 0; r < cohort.num_rooms(); r++) {
+        potential[cohort.rooms[r]] = ballot.solution.v[r];
+    }
+
+    Delta delta = parse_delta(opt.in_delta);
+
+    // Names are padded with spaces once anonymised
+    auto find = [&](std::string_view name) {
+        return std::find_if(people.begin(), people.end(), [&](Person const& p) {
+            std::string_view padded = p->name;
+            return padded.substr(0, padded.find_last_not_of(' ') + 1) == name;
+        });
+    };
+
+    for (auto&& name : delta.removed) {
+        auto it = find(name);
+
+        if (it == people.end()) {
+            throw std::runtime_error("No one called " + name + " in the ballot");
+        }
+
+        previous.erase(previous.begin() + (it - people.begin()));
+        people.erase(it);
+    }
+
+    // Late additions are appended to the anonymised order, hence lose ties within their priority
+    for (auto&& p : delta.added) {
+        if (find(p->name) != people.end()) {
+            throw std::runtime_error(p->name + " is already in the ballot");
+        }
+
+        anonymise(*p);
+
+        people.push_back(std::move(p));
+        previous.emplace_back(std::nullopt);
+    }
+
+    std::cout << "-- Removing " << delta.removed.size() << " and adding " << delta.added.size();
+    std::cout << " people, now " << people.size() << " in the ballot.\n";
+
+    order = results_order(people, ballot.max_rooms, kept);
+
+    head = cohort_people(people, order, kept);
+
+    Cohort next = intern(head, find_rooms(head), ballot.hostels, ballot.capacities);
+
+    Allocation allocation;
+    std::vector<bool> known;
+
+    for (std::size_t k = order.size() - kept; k < order.size(); k++) {
+        std::optional<Room> const& r = previous[order[k]];
+
+        known.push_back(r.has_value());
+        allocation.push_back(r && *r ? next.room_id(**r) : std::nullopt);
+    }
+
+    std::vector<double> v(next.num_rooms(), 0);
+
+    for (std::size_t r = 0; r < next.num_rooms(); r++) {
+        if (auto it = potential.find(next.rooms[r]); it != potential.end()) {
+            v[r] = it->second;
+        }
+    }
+
+    CostTable const table = cost_table(next, ballot.integer);
+
+    std::size_t augmentations = 0;
+
+    ballot.solution = repair(next, table, allocation, known, v, augmentations);
+
+    check_certificate(next, table, ballot.solution);
+
+    std::cout << "-- Repaired the allocation with " << augmentations << " augmenting paths\n";
+
+    // Results in the order of a fresh run
+    std::vector<std::pair<Person, Room>> results;
+
+    for (std::size_t k = 0; k < order.size(); k++) {
+        if (std::size_t first = order.size() - kept; k < first) {
+            results.emplace_back(people[order[k]], std::nullopt);
+        } else if (std::optional r = ballot.solution.allocation[k - first]) {
+            results.emplace_back(people[order[k]], next.rooms[*r]);
+        } else {
+            results.emplace_back(people[order[k]], std::nullopt);
+        }
+    }
+
+    ballot.people = std::move(people);
+    ballot.solver = Solver::sparse;
+    ballot.components = false;
+    ballot.presolve = false;
+    ballot.amended = true;
+
+    save_public(*opt.out_public, ballot, public_format(*opt.out_public, std::nullopt));
+
+    args.run.out_secret = opt.out_secret;
+
+    write_results(results, args);
+
+    analayse(results, [&](Room const& room) -> bool {
+        return room && next.hostel[*next.room_id(*room)];
+    });
+}
+
+// Counterfactuals for everyone in a ballot that has been run, by index in the results
+void explain_ballot(Args const& args) {
+    auto const& opt = args.explain;
+
+    PublicBallot const ballot = load_public(*opt.in_public);
+
+    std::size_t kept = 0;
+
+    std::vector order = results_order(ballot.people, ballot.max_rooms, kept);
+
+    std::vector head = cohort_people(ballot.people, order, kept);
+
+    Cohort cohort = intern(head, find_rooms(head), ballot.hostels, ballot.capacities);
+
+    CostTable const table = cost_table(cohort, ballot.integer);
+
+    // The updates are only as good as the duals they start from
+    check_certificate(cohort, table, ballot.solution);
+
+    std::cout << "-- Explaining the " << kept << " people who were allocated or kicked\n";
+
+    std::vector rows = explain(cohort, table, CostParams::of(), ballot.solution, *opt.threads);
+
+    std::vector<std::size_t> index;
+
+    for (std::size_t k = 0; k < kept; k++) {
+        index.push_back(order.size() - kept + k);
+    }
+
+    std::ofstream file(*opt.out);
+
+    write_explanations(file, index, rows);
+
+    // Lower rank is better, being kicked is worst
+    auto better = [](std::optional<std::uint32_t> a, std::optional<std::uint32_t> b) {
+        return a && (!b || *a < *b);
+    };
+
+    std::size_t priority_1 = 0;
+    std::size_t swapped = 0;
+
+    for (auto&& x : rows) {
+        priority_1 += better(x.priority_1, x.rank);
+        swapped += better(x.swapped, x.rank);
+    }
+
+    std::cout << "-- " << priority_1 << " would do better with priority 1, " << swapped;
+    std::cout << " by swapping their first two choices\n";
+    std::cout << "-- Wrote the explanations to " << *opt.out << '\n';
+}
+
+// Each person's outcomes over many shuffles of the people, how much tie-breaking matters
+void fairness_ballot(Args const& args) {
+    auto const& opt = args.fairness;
+
+    PeopleCsv const csv = read_people(opt.in_people);
+
+    std::map<std::string, std::size_t> capacities;
+
+    if (opt.capacities) {
+        capacities = parse_capacities(*opt.capacities);
+    }
+
+    // Everyone in the order of the csv
+    std::vector<std::size_t> all(csv.size());
+
+    std::iota(all.begin(), all.end(), 0);
+
+    Cohort cohort = intern(csv, all, opt.hostels, capacities);
+
+    CostTable const table = cost_table(cohort, *opt.integer);
+
+    std::cout << "-- Running the ballot of " << csv.size() << " people under " << *opt.orders;
+    std::cout << " orders\n";
+
+    // The first order is the one run would use
+    auto order = [&](std::size_t k) { return shuffled_order(csv, k); };
+
+    std::vector rows
+        = fairness(cohort, table, *opt.orders, order, opt.max_rooms, *opt.solver, *opt.threads);
+
+    std::vector<std::string_view> names;
+
+    for (std::size_t i = 0; i < csv.size(); i++) {
+        names.push_back(csv.name(i));
+    }
+
+    std::ofstream file(*opt.out);
+
+    write_fairness(file, names, cohort.priority, rows);
+
+    std::size_t varies = std::count_if(rows.begin(), rows.end(), [](Outcomes const& x) {
+        return x.varies();
+    });
+
+    std::cout << "-- The outcome of " << varies << " people depends on the order\n";
+    std::cout << "-- Wrote the outcomes to " << *opt.out << '\n';
+}
+
 int main(int argc, char* argv[]) {
     // Automagically parses
     Args args{argc, argv};
@@ -50,39 +541,103 @@ int main(int argc, char* argv[]) {
     std::cout << "-- Welcome to the Churchill MCR's room-ballot code!\n\n";
 
     if (args.cycle.has_value()) {
-        std::vector people = parse_people(args.cycle.in_people);
+        report_k_cycles(args.cycle.ks, read_people(args.cycle.in_people));
+        return 0;
+    }
 
-        for (auto&& k : args.cycle.ks) {
-            report_k_cycles(k, people);
-        }
+    if (args.sweep.has_value()) {
+        sweep_costs(args);
         return 0;
     }
 
-    std::vector people = load_people(args);
+    if (args.amend.has_value()) {
+        amend_ballot(args);
+        return 0;
+    }
 
-    std::cout << "-- There are " << people.size() << " people in the ballot.\n";
+    if (args.fairness.has_value()) {
+        fairness_ballot(args);
+        return 0;
+    }
 
-    // Must sort as we kick the (numerically highest) priority, use stable sort for
-    // implementation inter-compatibility. All currently valid so can deference :)
-    std::stable_sort(people.begin(), people.end(), [](Person const& a, Person const& b) {
-        return a->priority < b->priority;
-    });
+    if (args.explain.has_value()) {
+        explain_ballot(args);
+        return 0;
+    }
 
-    // Final people:room pairs stored here.
-    std::vector<std::pair<Person, Room>> results{};
+    if (args.similar.has_value()) {
+        PeopleCsv const csv = read_people(args.similar.in_people);
 
-    // Need to remove the people who missed the ballot
-    if (args.run.max_rooms) {
-        std::cout << "-- You want to limit the number of rooms to " << *args.run.max_rooms << '\n';
+        report_similar(csv, *args.similar.threshold, *args.similar.bands, *args.similar.rows);
+
+        return 0;
+    }
+
+    if (args.batch.has_value()) {
+        // Batch verification shares the options of verify
+        args.verify.in_public = args.batch.in_public;
+        args.verify.threads = args.batch.threads;
+        args.verify.resolve = args.batch.resolve;
+        args.verify.profile = args.batch.profile;
     }
-    while (!people.empty() && args.run.max_rooms && people.size() > *args.run.max_rooms) {
-        results.emplace_back(std::move(people.back()), std::nullopt);
-        people.pop_back();
+
+    // Only when asked for, measuring the peak memory of each phase costs a few system calls
+    std::optional<Profile> profiling;
+
+    if (profile_name(args)) {
+        profiling.emplace();
     }
 
-    std::vector rooms = find_rooms(people);
+    Profile* const profile = profiling ? &*profiling : nullptr;
+
+    std::map<std::string, std::size_t> capacities;
+
+    Solution certificate;
+
+    bool amended = false;
+
+    std::optional<PeopleCsv> csv;
+
+    std::vector<std::size_t> rows;
+
+    std::vector people = load_people(args, capacities, certificate, amended, csv, rows, profile);
+
+    std::cout << "-- There are " << people.size() << " people in the ballot.\n";
 
-    std::cout << "-- Between them they selected " << rooms.size() << " rooms, ";
+    std::optional<std::pair<std::size_t, std::size_t>> range;
+
+    if (args.run.has_value() && args.run.max_rooms_range) {
+        range = parse_range(*args.run.max_rooms_range);
+    } else if (args.run.max_rooms) {
+        std::cout << "-- You want to limit the number of rooms to " << *args.run.max_rooms << '\n';
+    }
+
+    // Those who missed the ballot (the numerically highest priorities) then the rest by priority,
+    // a range is solved up to its end
+    std::size_t kept = 0;
+
+    std::vector order = results_order(people, range ? range->second : args.run.max_rooms, kept);
+
+    std::size_t const first = order.size() - kept;
+
+    // Straight from the csv when run, the public ballot only has the people
+    Cohort cohort = [&] {
+        if (csv) {
+            std::vector<std::size_t> head;
+
+            for (std::size_t k = first; k < order.size(); k++) {
+                head.push_back(rows[order[k]]);
+            }
+
+            return intern(*csv, head, args.run.hostels, capacities);
+        }
+
+        std::vector head = cohort_people(people, order, kept);
+
+        return intern(head, find_rooms(head), args.run.hostels, capacities);
+    }();
+
+    std::cout << "-- Between them they selected " << cohort.num_rooms() << " rooms, ";
 
     auto is_hostel = [&](Room const& room) -> bool {
         if (room && args.run.hostels) {
@@ -95,39 +650,136 @@ int main(int argc, char* argv[]) {
         return false;
     };
 
-    std::size_t count = 0;
+    std::size_t count = std::count(cohort.hostel.begin(), cohort.hostel.end(), true);
 
-    for (auto&& room : rooms) {
-        if (is_hostel(room)) {
-            ++count;
-        }
+    std::cout << "of which " << count << " are hostels.\n";
+
+    lap(profile, "intern");
+
+    if (profile) {
+        profile->count("people", cohort.num_people());
+        profile->count("rooms", cohort.num_rooms());
+        profile->count("choices", cohort.room.size());
     }
 
-    std::cout << "of which " << count << " are hostels.\n";
+    if (range) {
+        sweep_max_rooms(args, range->first, cohort, people, order, profile);
+        save_profile(args, profile);
+        return 0;
+    }
 
-    // For every real person we need the possibility of them being kicked off the ballot
-    rooms.resize(people.size() + rooms.size(), std::nullopt);
+    // Not recorded in the public ballot as it does not change the results
+    std::size_t threads = args.run.has_value() ? *args.run.threads : *args.verify.threads;
 
-    // Must pad people (always more than rooms) with null people for balanced assignment
-    people.resize(rooms.size(), std::nullopt);
+    SolveOptions const options{
+        *args.run.solver, threads, *args.run.components, *args.run.presolve, profile};
 
-    linear_assignment(people, rooms, [&](Person const& p, Room const& r) {
-        return cost_function(p, r, is_hostel);
-    });
+    if (profile) {
+        profile->info("solver", solver_name(options.solver));
+        profile->info("costs", *args.run.integer ? "integer" : "double");
+    }
+
+    CostTable const table = cost_table(cohort, *args.run.integer);
+
+    lap(profile, "table");
+
+    Solution solution;
 
-    // Build results
-    for (std::size_t i = 0; i < people.size(); i++) {
-        results.emplace_back(std::move(people[i]), std::move(rooms[i]));
+    // Ballots written before certificates were published can only be verified by re-solving
+    bool const certified = !certificate.allocation.empty() || cohort.num_people() == 0;
+
+    if (args.run.has_value()) {
+        solution = solve(cohort, table, options);
+        lap(profile, "solve");
+        save_public(args, people, capacities, solution);
+        lap(profile, "save_public");
+    } else if (!*args.verify.resolve && certified) {
+        // Linear time, proves the published allocation is a global minimum
+        check_certificate(cohort, table, certificate);
+        lap(profile, "certificate");
+        std::cout << "-- The published allocation is provably optimal!\n";
+        solution = std::move(certificate);
+    } else {
+        if (!certified) {
+            std::cout << "-- The public ballot has no certificate, re-solving it\n";
+        }
+
+        // Re-solving is expensive, repeat verifications of the same ballot use the cache
+        std::string hash = hash_file(*args.verify.in_public);
+
+        std::optional cached = load_cache(*args.verify.in_public, hash);
+
+        // Anyone can write a cache with the right key, only one that is provably optimal (which
+        // also checks its sizes and room ids) is trusted, at worst it is another optimum
+        if (cached) {
+            try {
+                check_certificate(cohort, table, *cached);
+            } catch (std::runtime_error const& e) {
+                std::cout << "-- Ignoring the solution cache: " << e.what() << '\n';
+                cached.reset();
+            }
+        }
+
+        if (cached) {
+            std::cout << "-- Using the cached solution of this ballot\n";
+            solution = std::move(*cached);
+            lap(profile, "cache");
+        } else {
+            solution = solve(cohort, table, options);
+            lap(profile, "solve");
+
+            if (!save_cache(*args.verify.in_public, hash, solution)) {
+                std::cout << "-- Could not write the solution cache\n";
+            }
+        }
+
+        if (certified && amended) {
+            // Repairs keep people where they were, a fresh solve may break ties differently, so
+            // only the total cost must match (to the tolerance of check_certificate per person)
+            std::optional published = total_cost(cohort, table, certificate.allocation);
+            std::optional resolved = total_cost(cohort, table, solution.allocation);
+
+            if (!published) {
+                std::cout << "-- Warning: the published allocation is not one of this ballot!\n";
+            } else if (std::abs(*published - resolved.value()) > 1e-9 * cohort.num_people()) {
+                std::cout << "-- Warning: the published allocation costs more than the re-solved";
+                std::cout << " one!\n";
+            }
+        } else if (certified && solution.allocation != certificate.allocation) {
+            std::cout << "-- Warning: the published allocation differs from the re-solved one!\n";
+        }
     }
 
-    // NOTE : people, rooms are All moved from
+    // Final people:room pairs stored here.
+    std::vector<std::pair<Person, Room>> results{};
+
+    for (std::size_t k = 0; k < order.size(); k++) {
+        if (k < first) {
+            results.emplace_back(std::move(people[order[k]]), std::nullopt);
+        } else if (std::optional r = solution.allocation[k - first]) {
+            results.emplace_back(std::move(people[order[k]]), cohort.rooms[*r]);
+        } else {
+            results.emplace_back(std::move(people[order[k]]), std::nullopt);
+        }
+    }
+
+    // NOTE : people are All moved from
 
     if (args.run.has_value()) {
         write_results(results, args);
         analayse(results, is_hostel);
+    } else if (args.batch.has_value()) {
+        for (auto&& [index, one_time_pad] : parse_pairs(args.batch.in_pairs)) {
+            std::cout << "\n-- Index " << index << '\n';
+            highlight_results(results, index, one_time_pad);
+        }
     } else {
-        highlight_results(results, args);
+        highlight_results(results, args.verify.index, args.verify.one_time_pad);
     }
 
+    lap(profile, "results");
+
+    save_profile(args, profile);
+
     return 0;
 }
@@ -0,0 +1,77 @@
+// Copyright (C) 2020 Conor Williams
+
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <thread>
+#include <vector>
+
+// Number of threads to use when the user asks for zero (i.e. "all of them")
+inline std::size_t resolve_threads(std::size_t threads) {
+    return threads ? threads : std::max(1u, std::thread::hardware_concurrency());
+}
+
+/*
+ *  Split [0, n) into contiguous blocks and call f(begin, end) on each, using up to "threads"
+ *  threads including the calling one. Block boundaries depend only on n and threads, the first
+ *  exception thrown by any block is re-thrown once all blocks have finished.
+ */
+template <typename F> void parallel_for(std::size_t n, std::size_t threads, F&& f) {
+    threads = std::min(resolve_threads(threads), n);
+
+    if (threads <= 1) {
+        if (n > 0) {
+            f(std::size_t{0}, n);
+        }
+        return;
+    }
+
+    std::vector<std::exception_ptr> errors(threads);
+    std::vector<std::thread> pool;
+
+    auto block = [&](std::size_t t) {
+        try {
+            f(n * t / threads, n * (t + 1) / threads);
+        } catch (...) {
+            errors[t] = std::current_exception();
+        }
+    };
+
+    for (std::size_t t = 1; t < threads; t++) {
+        pool.emplace_back(block, t);
+    }
+
+    block(0);
+
+    for (auto&& thread : pool) {
+        thread.join();
+    }
+
+    for (auto&& err : errors) {
+        if (err) {
+            std::rethrow_exception(err);
+        }
+    }
+}
+
+/*
+ *  Call f(i) for every i in [0, n) using up to "threads" threads including the calling one. Tasks
+ *  are handed out in order as threads become free, hence suited to tasks of uneven size (put the
+ *  largest first). Exceptions are handled as in parallel_for.
+ */
+template <typename F> void parallel_tasks(std::size_t n, std::size_t threads, F&& f) {
+    std::atomic<std::size_t> next = 0;
+
+    parallel_for(std::min(resolve_threads(threads), n), threads, [&](std::size_t, std::size_t) {
+        for (std::size_t i = next++; i < n; i = next++) {
+            f(i);
+        }
+    });
+}
@@ -0,0 +1,172 @@
+// Copyright (C) 2020 Conor Williams
+
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include "presolve.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <optional>
+#include <vector>
+
+#include "cohort.hpp"
+#include "cost.hpp"
+#include "solve.hpp"
+
+Presolved presolve(Cohort const& c, CostTable const& t) {
+    std::size_t const n = c.num_people();
+    std::size_t const m = c.num_rooms();
+
+    auto cost = [&](std::size_t i, std::size_t e) {
+        return t.choice(i, c.rank[e], c.hostel[c.room[e]]);
+    };
+
+    // A choice is an option if it can beat kicking and the room can take someone
+    auto option = [&](std::size_t i, std::size_t e) {
+        return c.capacity[c.room[e]] > 0 && cost(i, e) <= t.kick_cost();
+    };
+
+    std::vector<std::uint32_t> demand(m, 0);
+
+    for (std::size_t i = 0; i < n; i++) {
+        for (std::size_t e = c.row_start[i]; e < c.row_start[i + 1]; e++) {
+            if (option(i, e)) {
+                ++demand[c.room[e]];
+            }
+        }
+    }
+
+    Presolved p{.table = t.select({})};
+
+    p.fixed.resize(n);
+    p.is_fixed.resize(n, false);
+
+    std::vector<std::uint32_t> capacity = c.capacity;
+
+    for (std::size_t i = 0; i < n; i++) {
+        std::optional<std::uint32_t> best;
+        double best_cost = t.kick_cost();
+        bool strict = true;
+
+        for (std::size_t e = c.row_start[i]; e < c.row_start[i + 1]; e++) {
+            if (!option(i, e)) {
+                continue;
+            } else if (double x = cost(i, e); x < best_cost) {
+                best = c.room[e];
+                best_cost = x;
+                strict = true;
+            } else if (x == best_cost) {
+                strict = false;
+            }
+        }
+
+        if (!strict) {
+            continue;
+        } else if (!best) {
+            p.is_fixed[i] = true;
+            p.kicked += 1;
+        } else if (demand[*best] <= c.capacity[*best]) {
+            p.is_fixed[i] = true;
+            p.fixed[i] = best;
+            capacity[*best] -= 1;
+        }
+    }
+
+    // What the remaining people still want
+    std::fill(demand.begin(), demand.end(), 0);
+
+    for (std::uint32_t i = 0; i < n; i++) {
+        if (!p.is_fixed[i]) {
+            p.people.push_back(i);
+
+            for (std::size_t e = c.row_start[i]; e < c.row_start[i + 1]; e++) {
+                if (option(i, e)) {
+                    ++demand[c.room[e]];
+                }
+            }
+        }
+    }
+
+    std::vector<std::uint32_t> id(m, 0);
+
+    for (std::uint32_t r = 0; r < m; r++) {
+        if (demand[r] > 0) {
+            id[r] = p.rooms.size();
+            p.rooms.push_back(r);
+            p.cohort.rooms.push_back(c.rooms[r]);
+            p.cohort.hostel.push_back(c.hostel[r]);
+            p.cohort.capacity.push_back(std::min(capacity[r], demand[r]));
+            p.places_dropped += capacity[r] - p.cohort.capacity.back();
+        }
+    }
+
+    for (std::uint32_t i : p.people) {
+        p.cohort.priority.push_back(c.priority[i]);
+        p.cohort.n_pref.push_back(c.n_pref[i]);
+
+        for (std::size_t e = c.row_start[i]; e < c.row_start[i + 1]; e++) {
+            if (option(i, e)) {
+                p.cohort.room.push_back(id[c.room[e]]);  // Ids are increasing, stays sorted
+                p.cohort.rank.push_back(c.rank[e]);
+            } else {
+                p.choices_dropped += 1;
+            }
+        }
+
+        p.cohort.row_start.push_back(p.cohort.room.size());
+    }
+
+    p.table = t.select(p.people);
+
+    return p;
+}
+
+/*
+ *  Rooms outside the reduced problem are either unwanted by the remaining people or had more places
+ *  than they wanted, hence have spare capacity and potential zero. So may any room that lost places
+ *  (to fixed people or the cap), as no more people want it than it can hold. The people's
+ *  potentials are then made tight with their rooms, a fixed person's strictly cheapest option has
+ *  non-negative reduced costs against any non-positive room potentials.
+ */
+Solution Presolved::expand(Cohort const& c, CostTable const& t, Solution const& sub) const {
+    Solution sol;
+
+    sol.allocation = fixed;
+    sol.v.assign(c.num_rooms(), 0);
+
+    for (std::size_t i = 0; i < people.size(); i++) {
+        if (std::optional r = sub.allocation[i]) {
+            sol.allocation[people[i]] = rooms[*r];
+        }
+    }
+
+    for (std::size_t r = 0; r < rooms.size(); r++) {
+        if (cohort.capacity[r] == c.capacity[rooms[r]]) {
+            sol.v[rooms[r]] = sub.v[r];
+        }
+    }
+
+    for (std::uint32_t i = 0; i < c.num_people(); i++) {
+        if (std::optional r = sol.allocation[i]) {
+            sol.u.push_back(t(c, i, r) - sol.v[*r]);
+        } else {
+            sol.u.push_back(t.kick_cost());
+        }
+    }
+
+    return sol;
+}
+
+std::ostream& operator<<(std::ostream& os, Presolved const& p) {
+    std::size_t const fixed = std::count(p.is_fixed.begin(), p.is_fixed.end(), true);
+
+    os << "fixed " << fixed << " people (" << p.kicked << " kicked), dropped ";
+    os << p.choices_dropped << " choices and " << p.places_dropped << " places, leaving ";
+    os << p.cohort.num_people() << " people and " << p.cohort.num_rooms() << " rooms";
+
+    return os;
+}
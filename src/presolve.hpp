@@ -0,0 +1,50 @@
+// Copyright (C) 2020 Conor Williams
+
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+#include "cohort.hpp"
+#include "cost.hpp"
+#include "solve.hpp"
+
+/*
+ *  Reductions of a cohort that every optimal allocation agrees with:
+ *
+ *  - A choice costing more than kicking is never taken, nor is a room with no capacity.
+ *  - A person whose cheapest option is strictly cheaper than the rest is fixed to it when it is
+ *    kicking or a room no more people want than it can hold, as no one competes for it.
+ *  - A room is only needed by the people left and only needs as many places as they want.
+ *
+ *  The remaining people form a smaller problem (of which the dense backends have fewer rows, slots
+ *  and kick columns) whose optimum, with the fixed people, is an optimum of the whole cohort.
+ */
+struct Presolved {
+    Cohort cohort{};  // The reduced problem
+    CostTable table;  // Of the reduced problem
+
+    std::vector<std::uint32_t> people{};  // Reduced person id -> person id
+    std::vector<std::uint32_t> rooms{};   // Reduced room id -> room id
+
+    Allocation fixed{};            // Person id -> room, only meaningful for the fixed people
+    std::vector<bool> is_fixed{};  // Person id -> fixed by the presolve
+
+    std::size_t kicked = 0;           // Number of fixed people that are kicked
+    std::size_t choices_dropped = 0;  // Choices removed from the remaining people
+    std::size_t places_dropped = 0;   // Capacity removed from the remaining rooms
+
+    // Merge a solution of the reduced problem with the fixed people, in the ids of the cohort
+    [[nodiscard]] Solution expand(Cohort const&, CostTable const&, Solution const&) const;
+};
+
+Presolved presolve(Cohort const&, CostTable const&);
+
+// One line summary of how much the problem shrank
+std::ostream& operator<<(std::ostream&, Presolved const&);
@@ -0,0 +1,126 @@
+// Copyright (C) 2020 Conor Williams
+
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include "profile.hpp"
+
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <fstream>
+#include <iomanip>
+#include <mutex>
+#include <ostream>
+#include <string>
+
+double peak_rss() {
+    // Unlike ru_maxrss the high-water mark in the status file can be reset
+    std::ifstream status{"/proc/self/status"};
+
+    for (std::string line; std::getline(status, line);) {
+        if (line.starts_with("VmHWM:")) {
+            return std::stod(line.substr(6)) / 1024.0;  // In KiB
+        }
+    }
+
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss / 1024.0;  // Linux reports KiB
+}
+
+void reset_peak_rss() {
+    std::ofstream clear_refs{"/proc/self/clear_refs"};
+    clear_refs << '5';  // Resets VmHWM to the current RSS
+}
+
+Profile::Profile() { reset_peak_rss(); }
+
+void Profile::lap(std::string name) {
+    clock::time_point now = clock::now();
+
+    double const dt = std::chrono::duration<double>(now - m_last).count();
+
+    m_phases.push_back({std::move(name), dt, peak_rss()});
+
+    reset_peak_rss();
+
+    m_last = now;
+}
+
+void Profile::count(std::string const& name, std::size_t n) {
+    std::lock_guard lock{m_mutex};
+    m_counters[name] += n;
+}
+
+void Profile::time(std::string const& name, double seconds) {
+    std::lock_guard lock{m_mutex};
+    m_timers[name] += seconds;
+}
+
+double Profile::timer(std::string const& name) const {
+    std::lock_guard lock{m_mutex};
+    auto it = m_timers.find(name);
+    return it == m_timers.end() ? 0 : it->second;
+}
+
+void Profile::info(std::string const& name, std::string value) {
+    std::lock_guard lock{m_mutex};
+    m_info[name] = std::move(value);
+}
+
+// Names and values are plain identifiers/numbers, nothing needs escaping
+void Profile::write(std::ostream& os) const {
+    std::lock_guard lock{m_mutex};
+
+    os << std::setprecision(6) << "{\n";
+
+    os << "    \"seconds\": " << std::chrono::duration<double>(m_last - m_start).count() << ",\n";
+    double peak = peak_rss();
+
+    for (auto&& phase : m_phases) {
+        peak = std::max(peak, phase.peak_rss);
+    }
+
+    os << "    \"peak_rss_mib\": " << peak << ",\n";
+
+    os << "    \"phases\": [";
+
+    for (std::size_t i = 0; i < m_phases.size(); i++) {
+        os << (i ? ",\n" : "\n") << "        {\"name\": \"" << m_phases[i].name << "\", ";
+        os << "\"seconds\": " << m_phases[i].seconds << ", ";
+        os << "\"peak_rss_mib\": " << m_phases[i].peak_rss << '}';
+    }
+
+    os << "\n    ],\n";
+
+    os << "    \"counters\": {";
+
+    for (char const* sep = "\n"; auto&& [name, n] : m_counters) {
+        os << sep << "        \"" << name << "\": " << n;
+        sep = ",\n";
+    }
+
+    os << "\n    },\n";
+
+    os << "    \"timers\": {";
+
+    for (char const* sep = "\n"; auto&& [name, seconds] : m_timers) {
+        os << sep << "        \"" << name << "\": " << seconds;
+        sep = ",\n";
+    }
+
+    os << "\n    },\n";
+
+    os << "    \"info\": {";
+
+    for (char const* sep = "\n"; auto&& [name, value] : m_info) {
+        os << sep << "        \"" << name << "\": \"" << value << '"';
+        sep = ",\n";
+    }
+
+    os << "\n    }\n}\n";
+}
@@ -0,0 +1,74 @@
+// Copyright (C) 2020 Conor Williams
+
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Peak resident set size of this process in MiB since the last reset_peak_rss(), or its start
+double peak_rss();
+
+// Start a new peak from the current resident set size, where supported (Linux)
+void reset_peak_rss();
+
+// Wall time of f() in seconds
+template <typename F> double seconds(F&& f) {
+    auto start = std::chrono::steady_clock::now();
+    f();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+/*
+ *  Wall time and peak memory of the consecutive phases of a run, plus counters recorded by the
+ *  solvers, written as JSON. Each call to lap(name) ends the phase called name, which started at
+ *  the previous call (or construction), and resets the peak memory so that each phase reports its
+ *  own. Counters, timers and info may be recorded concurrently.
+ */
+class Profile {
+  public:
+    Profile();
+
+    void lap(std::string name);
+
+    // Add n to a counter
+    void count(std::string const& name, std::size_t n);
+
+    // Add to a timer of a step within a phase, e.g. building the cost matrix within the solve
+    void time(std::string const& name, double seconds);
+
+    // Total of a timer so far, zero if it was never added to
+    [[nodiscard]] double timer(std::string const& name) const;
+
+    // Record a string, e.g. the solver used
+    void info(std::string const& name, std::string value);
+
+    void write(std::ostream&) const;
+
+  private:
+    using clock = std::chrono::steady_clock;
+
+    struct Phase {
+        std::string name;
+        double seconds;
+        double peak_rss;  // MiB, during the phase
+    };
+
+    clock::time_point m_start = clock::now();
+    clock::time_point m_last = m_start;
+
+    std::vector<Phase> m_phases{};
+
+    mutable std::mutex m_mutex{};
+    std::map<std::string, std::size_t> m_counters{};
+    std::map<std::string, double> m_timers{};
+    std::map<std::string, std::string> m_info{};
+};
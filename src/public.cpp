@@ -0,0 +1,462 @@
+// Copyright (C) 2020 Conor Williams
+
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include "public.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <optional>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "ballot.hpp"
+#include "cereal/archives/json.hpp"
+#include "cereal/types/map.hpp"
+#include "cereal/types/optional.hpp"
+#include "cereal/types/string.hpp"
+#include "cereal/types/vector.hpp"
+#include "picosha2.h"
+#include "solve.hpp"
+
+namespace {  // Like static
+
+constexpr std::uint32_t none = 0xFFFFFFFF;  // Missing room id
+
+// Appends little-endian fields to a buffer
+class Writer {
+  public:
+    void u8(std::uint8_t x) { m_buff.push_back(x); }
+
+    void u32(std::uint32_t x) {
+        for (int i = 0; i < 4; i++) {
+            m_buff.push_back(x >> (8 * i));
+        }
+    }
+
+    void u64(std::uint64_t x) {
+        for (int i = 0; i < 8; i++) {
+            m_buff.push_back(x >> (8 * i));
+        }
+    }
+
+    void f64(double x) { u64(std::bit_cast<std::uint64_t>(x)); }
+
+    void str(std::string_view s) {
+        u32(s.size());
+        m_buff.insert(m_buff.end(), s.begin(), s.end());
+    }
+
+    void bytes(char const* data, std::size_t n) { m_buff.insert(m_buff.end(), data, data + n); }
+
+    std::vector<unsigned char>& buff() { return m_buff; }
+
+  private:
+    std::vector<unsigned char> m_buff{};
+};
+
+// Reads little-endian fields from a buffer, throws if they overrun it
+class Reader {
+  public:
+    Reader(unsigned char const* data, std::size_t size) : m_data(data), m_size(size) {}
+
+    std::uint8_t u8() { return *take(1); }
+
+    std::uint32_t u32() {
+        unsigned char const* p = take(4);
+        std::uint32_t x = 0;
+        for (int i = 0; i < 4; i++) {
+            x |= std::uint32_t{p[i]} << (8 * i);
+        }
+        return x;
+    }
+
+    std::uint64_t u64() {
+        unsigned char const* p = take(8);
+        std::uint64_t x = 0;
+        for (int i = 0; i < 8; i++) {
+            x |= std::uint64_t{p[i]} << (8 * i);
+        }
+        return x;
+    }
+
+    double f64() { return std::bit_cast<double>(u64()); }
+
+    std::string_view str() {
+        std::uint32_t n = u32();
+        return {reinterpret_cast<char const*>(take(n)), n};
+    }
+
+    // Length prefix of a sequence, at least one byte per element must remain
+    std::size_t count() {
+        std::uint64_t n = u64();
+        if (n > m_size - m_pos) {
+            throw std::runtime_error("Corrupt binary ballot: impossible length");
+        }
+        return n;
+    }
+
+    [[nodiscard]] bool done() const { return m_pos == m_size; }
+
+  private:
+    unsigned char const* take(std::size_t n) {
+        if (n > m_size - m_pos) {
+            throw std::runtime_error("Corrupt binary ballot: truncated");
+        }
+        m_pos += n;
+        return m_data + m_pos - n;
+    }
+
+    unsigned char const* m_data;
+    std::size_t m_size;
+    std::size_t m_pos = 0;
+};
+
+// Read-only memory map of a whole file
+class Mapped {
+  public:
+    explicit Mapped(std::string const& fname) {
+        int fd = ::open(fname.c_str(), O_RDONLY);
+
+        if (fd < 0) {
+            throw std::runtime_error("Could not open " + fname);
+        }
+
+        struct stat st {};
+
+        if (::fstat(fd, &st) == 0 && st.st_size > 0) {
+            m_size = st.st_size;
+            m_data = ::mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        }
+
+        ::close(fd);
+
+        if (m_data == MAP_FAILED) {
+            throw std::runtime_error("Could not map " + fname);
+        }
+    }
+
+    Mapped(Mapped const&) = delete;
+    Mapped& operator=(Mapped const&) = delete;
+
+    ~Mapped() {
+        if (m_size > 0) {
+            ::munmap(m_data, m_size);
+        }
+    }
+
+    [[nodiscard]] unsigned char const* data() const {
+        return static_cast<unsigned char const*>(m_data);
+    }
+
+    [[nodiscard]] std::size_t size() const { return m_size; }
+
+  private:
+    void* m_data = nullptr;
+    std::size_t m_size = 0;
+};
+
+// Bits of the flags word of the binary format
+constexpr std::uint32_t components_flag = 1;
+constexpr std::uint32_t presolve_flag = 2;
+constexpr std::uint32_t integer_flag = 4;
+constexpr std::uint32_t amended_flag = 8;
+
+constexpr std::uint32_t all_flags = components_flag | presolve_flag | integer_flag | amended_flag;
+
+std::uint32_t flags(PublicBallot const& ballot) {
+    return (ballot.components ? components_flag : 0u) | (ballot.presolve ? presolve_flag : 0u)
+           | (ballot.integer ? integer_flag : 0u) | (ballot.amended ? amended_flag : 0u);
+}
+
+// Unknown bits are from a newer writer, whose ballot this cannot reproduce
+void set_flags(PublicBallot& ballot, std::uint32_t flags) {
+    if (flags & ~all_flags) {
+        throw std::runtime_error("Unsupported binary ballot flags " + std::to_string(flags));
+    }
+
+    ballot.components = flags & components_flag;
+    ballot.presolve = flags & presolve_flag;
+    ballot.integer = flags & integer_flag;
+    ballot.amended = flags & amended_flag;
+}
+
+// Unknown solvers are from a newer writer, verifying with another would not reproduce the ballot
+Solver to_solver(std::uint32_t x) {
+    if (x > static_cast<std::uint32_t>(Solver::auction)) {
+        throw std::runtime_error("Unsupported public ballot solver " + std::to_string(x));
+    }
+
+    return static_cast<Solver>(x);
+}
+
+bool is_binary(unsigned char const* data, std::size_t size) {
+    return size >= sizeof(binary_magic)
+           && std::memcmp(data, binary_magic, sizeof(binary_magic)) == 0;
+}
+
+void save_binary(std::string const& fname, PublicBallot const& ballot) {
+    // Intern the rooms
+    std::set<std::string_view> names;
+
+    for (auto&& p : ballot.people) {
+        if (!p) {
+            throw std::invalid_argument("Null person in public ballot");
+        }
+        names.insert(p->pref.begin(), p->pref.end());
+    }
+
+    std::vector<std::string_view> rooms(names.begin(), names.end());
+
+    auto id = [&](std::string_view r) -> std::uint32_t {
+        return std::lower_bound(rooms.begin(), rooms.end(), r) - rooms.begin();
+    };
+
+    Writer w;
+
+    w.bytes(binary_magic, sizeof(binary_magic));
+    w.u32(binary_version);
+
+    w.u8(ballot.max_rooms.has_value());
+    w.u64(ballot.max_rooms.value_or(0));
+
+    w.u8(ballot.hostels.has_value());
+    w.u64(ballot.hostels ? ballot.hostels->size() : 0);
+
+    if (ballot.hostels) {
+        for (auto&& h : *ballot.hostels) {
+            w.str(h);
+        }
+    }
+
+    w.u32(static_cast<std::uint32_t>(ballot.solver));
+    w.u32(flags(ballot));
+
+    w.u64(ballot.capacities.size());
+
+    for (auto&& [room, cap] : ballot.capacities) {
+        w.str(room);
+        w.u64(cap);
+    }
+
+    w.u64(rooms.size());
+
+    for (std::string_view r : rooms) {
+        w.str(r);
+    }
+
+    w.u64(ballot.people.size());
+
+    for (auto&& p : ballot.people) {
+        w.u64(p->priority);
+        w.str(p->secret_name);
+        w.u64(p->pref.size());
+
+        for (auto&& r : p->pref) {
+            w.u32(id(r));
+        }
+    }
+
+    w.u64(ballot.solution.allocation.size());
+
+    for (auto&& r : ballot.solution.allocation) {
+        w.u32(r.value_or(none));
+    }
+
+    for (auto const* dual : {&ballot.solution.u, &ballot.solution.v}) {
+        w.u64(dual->size());
+        for (double x : *dual) {
+            w.f64(x);
+        }
+    }
+
+    auto& buff = w.buff();
+
+    std::vector<unsigned char> hash(picosha2::k_digest_size);
+    picosha2::hash256(buff.begin(), buff.end(), hash.begin(), hash.end());
+    buff.insert(buff.end(), hash.begin(), hash.end());
+
+    std::ofstream file(fname, std::ios::binary);
+    file.write(reinterpret_cast<char const*>(buff.data()), buff.size());
+
+    if (!file) {
+        throw std::runtime_error("Could not write " + fname);
+    }
+}
+
+PublicBallot load_binary(unsigned char const* data, std::size_t size) {
+    if (size < sizeof(binary_magic) + picosha2::k_digest_size) {
+        throw std::runtime_error("Corrupt binary ballot: truncated");
+    }
+
+    std::size_t const body = size - picosha2::k_digest_size;
+
+    std::vector<unsigned char> hash(picosha2::k_digest_size);
+    picosha2::hash256(data, data + body, hash.begin(), hash.end());
+
+    if (!std::equal(hash.begin(), hash.end(), data + body)) {
+        throw std::runtime_error("Corrupt binary ballot: hash mismatch");
+    }
+
+    Reader r{data + sizeof(binary_magic), body - sizeof(binary_magic)};
+
+    std::uint32_t const version = r.u32();
+
+    if (version == 0 || version > binary_version) {
+        throw std::runtime_error("Unsupported binary ballot version " + std::to_string(version));
+    }
+
+    PublicBallot ballot;
+
+    bool const has_max_rooms = r.u8();
+    std::uint64_t const max_rooms = r.u64();
+
+    if (has_max_rooms) {
+        ballot.max_rooms = max_rooms;
+    }
+
+    bool const has_hostels = r.u8();
+    std::vector<std::string> hostels(r.count());
+
+    for (auto&& h : hostels) {
+        h = r.str();
+    }
+
+    if (has_hostels) {
+        ballot.hostels = std::move(hostels);
+    }
+
+    ballot.solver = to_solver(r.u32());
+
+    // Version 1 predates the flags, they are all off
+    if (version > 1) {
+        set_flags(ballot, r.u32());
+    }
+
+    for (std::size_t i = 0, n = r.count(); i < n; i++) {
+        std::string room{r.str()};
+        ballot.capacities[room] = r.u64();
+    }
+
+    std::vector<std::string_view> rooms(r.count());
+
+    for (auto&& room : rooms) {
+        room = r.str();
+    }
+
+    ballot.people.resize(r.count());
+
+    for (auto&& p : ballot.people) {
+        p.emplace();
+        p->priority = r.u64();
+        p->secret_name = r.str();
+        p->pref.resize(r.count());
+
+        for (auto&& choice : p->pref) {
+            std::uint32_t id = r.u32();
+            if (id >= rooms.size()) {
+                throw std::runtime_error("Corrupt binary ballot: unknown room");
+            }
+            choice = rooms[id];
+        }
+    }
+
+    ballot.solution.allocation.resize(r.count());
+
+    for (auto&& a : ballot.solution.allocation) {
+        if (std::uint32_t id = r.u32(); id != none) {
+            a = id;
+        }
+    }
+
+    for (auto* dual : {&ballot.solution.u, &ballot.solution.v}) {
+        dual->resize(r.count());
+        for (double& x : *dual) {
+            x = r.f64();
+        }
+    }
+
+    if (!r.done()) {
+        throw std::runtime_error("Corrupt binary ballot: trailing bytes");
+    }
+
+    return ballot;
+}
+
+}  // namespace
+
+Format public_format(std::string const& fname, std::optional<Format> format) {
+    if (format) {
+        return *format;
+    }
+    return fname.ends_with(".bin") ? Format::binary : Format::json;
+}
+
+void save_public(std::string const& fname, PublicBallot const& ballot, Format format) {
+    if (format == Format::binary) {
+        save_binary(fname, ballot);
+    } else {
+        std::ofstream file(fname);
+        cereal::JSONOutputArchive archive(file);
+        archive(ballot.max_rooms,
+                ballot.hostels,
+                ballot.people,
+                ballot.solver,
+                ballot.components,
+                ballot.presolve,
+                ballot.integer,
+                ballot.capacities,
+                ballot.solution,
+                ballot.amended);
+    }
+}
+
+PublicBallot load_public(std::string const& fname) {
+    {
+        Mapped map{fname};
+
+        if (is_binary(map.data(), map.size())) {
+            return load_binary(map.data(), map.size());
+        }
+    }
+
+    PublicBallot ballot;
+
+    std::ifstream file(fname);
+    cereal::JSONInputArchive archive(file);
+    archive(ballot.max_rooms, ballot.hostels, ballot.people);
+
+    // The fields after the people were appended over time, older ballots end early
+    auto optional = [&](auto& field) {
+        if (archive.getNodeName() != nullptr) {
+            archive(field);
+        }
+    };
+
+    optional(ballot.solver);
+
+    ballot.solver = to_solver(static_cast<std::uint32_t>(ballot.solver));
+    optional(ballot.components);
+    optional(ballot.presolve);
+    optional(ballot.integer);
+    optional(ballot.capacities);
+    optional(ballot.solution);
+    optional(ballot.amended);
+
+    return ballot;
+}
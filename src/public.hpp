@@ -0,0 +1,52 @@
+// Copyright (C) 2020 Conor Williams
+
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "ballot.hpp"
+#include "solve.hpp"
+
+// Everything required to verify a ballot, people are in anonymised order. Ballots written before a
+// field existed load with its default, in particular without a solution (certificate).
+struct PublicBallot {
+    std::optional<std::size_t> max_rooms{};
+    std::optional<std::vector<std::string>> hostels{};
+    std::vector<Person> people{};
+    Solver solver = Solver::lapjv;
+    bool components = false;
+    bool presolve = false;
+    bool integer = false;
+    std::map<std::string, std::size_t> capacities{};
+    Solution solution{};
+    bool amended = false;  // Repaired by amend, not what a fresh solve would break ties to
+};
+
+/*
+ *  The binary format is a magic string and version followed by length-prefixed little-endian
+ *  fields, choices are stored as ids into an interned table of room names. It ends with the
+ *  SHA-256 of everything before it, which is checked on load. Version 2 added a word of flags
+ *  (components, presolve, integer) after the solver, new options add a bit rather than a field.
+ *  Version 1 files load with every flag off, bits a reader does not know are rejected.
+ */
+inline constexpr char binary_magic[8] = {'M', 'C', 'R', 'B', 'A', 'L', 'L', 'T'};
+inline constexpr std::uint32_t binary_version = 2;
+
+// Format to write fname in, an explicit choice wins, otherwise binary iff it ends in ".bin"
+Format public_format(std::string const& fname, std::optional<Format> format = std::nullopt);
+
+// Write in the given format
+void save_public(std::string const& fname, PublicBallot const&, Format);
+
+// Read either format, binary files are detected by their magic string. They are memory mapped but
+// not used in place, every room name and person is copied into the ballot in a single pass.
+PublicBallot load_public(std::string const& fname);
@@ -8,16 +8,24 @@
 
 #include <algorithm>
 #include <cstddef>
+#include <cstdint>
 #include <iterator>
+#include <numeric>
 #include <random>
 #include <stdexcept>
 #include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
 
 #include "ballot.hpp"
+#include "ingest.hpp"
 #include "picosha2.h"
 
 namespace {  // Like static
 
+constexpr std::size_t name_len = 32;  // Names are padded to this before encryption
+
 constexpr char charset[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz";
 
 std::random_device true_rng{};
@@ -32,6 +40,29 @@ std::string random_string(std::size_t len) {
     return out;
 }
 
+// Shuffle the sorted order with a generator seeded from a hash of the entropy, extended by the
+// alternative if it is not zero
+void seeded_shuffle(std::vector<std::size_t>& order,
+                    std::string const& entropy,
+                    std::uint64_t alternative) {
+    // Hash for security
+    std::vector<unsigned char> hash(picosha2::k_digest_size);
+    picosha2::hash256(entropy.begin(), entropy.end(), hash.begin(), hash.end());
+
+    // Alternatives extend the seed, the ballot's own (zero) does not
+    for (int b = 0; alternative && b < 8; b++) {
+        hash.push_back((alternative >> (8 * b)) & 0xFF);
+    }
+
+    // Seed random number generator
+    std::seed_seq s(hash.begin(), hash.end());
+    std::mt19937 gen;
+    gen.seed(s);
+
+    // Now in almost-random order
+    std::shuffle(order.begin(), order.end(), gen);
+}
+
 }  // namespace
 
 std::string string_xor(std::string const& a, std::string const& b) {
@@ -46,6 +77,78 @@ std::string string_xor(std::string const& a, std::string const& b) {
     return out;
 }
 
+void anonymise(impl::Person& p) {
+    if (p.name.size() > name_len) {
+        throw std::runtime_error("Name too long");
+    }
+
+    // Must pad all names to name_len to avoid leaking information
+    p.name.resize(name_len, ' ');
+    p.one_time_pad = random_string(name_len);
+    p.secret_name = string_xor(p.name, p.one_time_pad);
+}
+
+std::vector<std::size_t> shuffled_order(std::vector<Person> const& people,
+                                        std::uint64_t alternative) {
+    std::vector<std::size_t> order(people.size());
+
+    std::iota(order.begin(), order.end(), 0);
+
+    // Sort so results cannot be determined by input sequence ordering
+    std::stable_sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) {
+        return people[a] < people[b];
+    });
+
+    // Build seed deterministically
+    std::string entropy;
+
+    for (std::size_t i : order) {
+        if (people[i]) {
+            entropy.append(people[i]->name);
+        }
+    }
+
+    seeded_shuffle(order, entropy, alternative);
+
+    return order;
+}
+
+std::vector<std::size_t> shuffled_order(PeopleCsv const& csv, std::uint64_t alternative) {
+    // The names padded as by anonymise, in one buffer
+    std::string padded(csv.size() * name_len, ' ');
+
+    for (std::size_t i = 0; i < csv.size(); i++) {
+        if (csv.name(i).size() > name_len) {
+            throw std::runtime_error("Name too long");
+        }
+        std::copy(csv.name(i).begin(), csv.name(i).end(), padded.begin() + i * name_len);
+    }
+
+    auto name = [&](std::size_t i) {
+        return std::string_view{padded}.substr(i * name_len, name_len);
+    };
+
+    std::vector<std::size_t> order(csv.size());
+
+    std::iota(order.begin(), order.end(), 0);
+
+    std::stable_sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) {
+        return name(a) < name(b);
+    });
+
+    std::string entropy;
+
+    entropy.reserve(padded.size());
+
+    for (std::size_t i : order) {
+        entropy.append(name(i));
+    }
+
+    seeded_shuffle(order, entropy, alternative);
+
+    return order;
+}
+
 // Here we want to deterministically "randomise" the order of the people and encrypt their names
 void anonymise_sort(std::vector<Person>& people) {
     // Find longest name
@@ -61,42 +164,21 @@ void anonymise_sort(std::vector<Person>& people) {
         return w;
     }();
 
-    constexpr size_t len = 32;
-
-    if (w > len) {
+    if (w > name_len) {
         throw std::runtime_error("Name too long");
     }
 
-    // Must pad all names to len to avoid leaking information
     for (auto&& p : people) {
         if (p) {
-            p->name.resize(len, ' ');
-            p->one_time_pad = random_string(len);
-            p->secret_name = string_xor(p->name, p->one_time_pad);
+            anonymise(*p);
         }
     }
 
-    // Sort so results cannot be determined by input sequence ordering
-    std::stable_sort(people.begin(), people.end());
+    std::vector<Person> shuffled;
 
-    // Build seed deterministically
-    std::string entropy;
-
-    for (auto&& p : people) {
-        if (p) {
-            entropy.append(p->name);
-        }
+    for (std::size_t i : shuffled_order(people, 0)) {
+        shuffled.push_back(std::move(people[i]));
     }
 
-    // Hash for security
-    std::vector<unsigned char> hash(picosha2::k_digest_size);
-    picosha2::hash256(entropy.begin(), entropy.end(), hash.begin(), hash.end());
-
-    // Seed random number generator
-    std::seed_seq s(hash.begin(), hash.end());
-    std::mt19937 gen;
-    gen.seed(s);
-
-    // Now in almost-random order
-    std::shuffle(people.begin(), people.end(), gen);
+    people = std::move(shuffled);
 }
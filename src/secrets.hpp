@@ -6,8 +6,27 @@
 
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
 #include "ballot.hpp"
+#include "ingest.hpp"
 
 std::string string_xor(std::string const&, std::string const&);
 
+// Pad the name and encrypt it with a fresh one time pad
+void anonymise(impl::Person&);
+
+/*
+ *  The "random" order anonymise_sort puts (already anonymised) people in, as indices. The shuffle
+ *  is seeded from a hash of the sorted padded names, for alternative > 0 extended by alternative,
+ *  so each alternative is another order equally fixed by the names. Alternative 0 is the ballot's.
+ */
+std::vector<std::size_t> shuffled_order(std::vector<Person> const&, std::uint64_t alternative);
+
+// The same order of the people of a csv (as rows, before anonymising), without building them
+std::vector<std::size_t> shuffled_order(PeopleCsv const&, std::uint64_t alternative);
+
 void anonymise_sort(std::vector<Person>&);
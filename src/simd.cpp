@@ -0,0 +1,197 @@
+// Copyright (C) 2020 Conor Williams
+
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include "simd.hpp"
+
+#ifdef __x86_64__
+#    include <immintrin.h>
+#endif
+
+#include <atomic>
+#include <cstdint>
+
+namespace {  // Like static
+
+std::atomic<bool> disabled = false;
+
+// ---- Scalar versions, the reference ----
+
+// One step of the augmenting row reduction's scan from lap()
+template <typename T> void top2_step(simd::Top2<T>& t, T h, int j) {
+    if (h < t.m2) {
+        if (h >= t.m1) {
+            t.m2 = h;
+            t.j2 = j;
+        } else {
+            t.m2 = t.m1;
+            t.j2 = t.j1;
+            t.m1 = h;
+            t.j1 = j;
+        }
+    }
+}
+
+// From (c[0] - v[0], 0, big, 0) step through j in [1, n)
+template <typename T> simd::Top2<T> top2_scalar(T const* c, T const* v, int n, T big) {
+    simd::Top2<T> t{c[0] - v[0], 0, big, 0};
+
+    for (int j = 1; j < n; j++) {
+        top2_step(t, c[j] - v[j], j);
+    }
+
+    return t;
+}
+
+template <typename T> void column_min_scalar(T const* row, int n, int i, T* min, int* imin) {
+    for (int j = 0; j < n; j++) {
+        if (row[j] < min[j]) {
+            min[j] = row[j];
+            imin[j] = i;
+        }
+    }
+}
+
+#ifdef __x86_64__
+
+bool const supported = __builtin_cpu_supports("avx2");
+
+/*
+ *  A step of the scan only does anything if h < m2, which becomes rare, hence compare a vector of h
+ *  to m2 and only step through (in order) the vectors with a lane below it. As m2 only decreases
+ *  the skipped lanes would not have done anything either.
+ */
+__attribute__((target("avx2"))) simd::Top2<double> top2_avx2(double const* c,
+                                                             double const* v,
+                                                             int n,
+                                                             double big) {
+    simd::Top2<double> t{c[0] - v[0], 0, big, 0};
+
+    int j = 1;
+
+    for (; j + 4 <= n; j += 4) {
+        __m256d const h = _mm256_sub_pd(_mm256_loadu_pd(c + j), _mm256_loadu_pd(v + j));
+
+        if (_mm256_movemask_pd(_mm256_cmp_pd(h, _mm256_set1_pd(t.m2), _CMP_LT_OQ))) {
+            for (int l = j; l < j + 4; l++) {
+                top2_step(t, c[l] - v[l], l);
+            }
+        }
+    }
+
+    for (; j < n; j++) {
+        top2_step(t, c[j] - v[j], j);
+    }
+
+    return t;
+}
+
+__attribute__((target("avx2"))) simd::Top2<std::int32_t> top2_avx2(std::int32_t const* c,
+                                                                   std::int32_t const* v,
+                                                                   int n,
+                                                                   std::int32_t big) {
+    simd::Top2<std::int32_t> t{c[0] - v[0], 0, big, 0};
+
+    int j = 1;
+
+    for (; j + 8 <= n; j += 8) {
+        __m256i const h
+            = _mm256_sub_epi32(_mm256_loadu_si256(reinterpret_cast<__m256i const*>(c + j)),
+                               _mm256_loadu_si256(reinterpret_cast<__m256i const*>(v + j)));
+
+        if (!_mm256_testz_si256(_mm256_cmpgt_epi32(_mm256_set1_epi32(t.m2), h),
+                                _mm256_set1_epi32(-1))) {
+            for (int l = j; l < j + 8; l++) {
+                top2_step(t, c[l] - v[l], l);
+            }
+        }
+    }
+
+    for (; j < n; j++) {
+        top2_step(t, c[j] - v[j], j);
+    }
+
+    return t;
+}
+
+// Set imin[j + b] = i for every set bit b of mask
+inline void scatter(unsigned mask, int j, int i, int* imin) {
+    for (; mask; mask &= mask - 1) {
+        imin[j + __builtin_ctz(mask)] = i;
+    }
+}
+
+__attribute__((target("avx2"))) void column_min_avx2(
+    double const* row, int n, int i, double* min, int* imin) {
+    int j = 0;
+
+    for (; j + 4 <= n; j += 4) {
+        __m256d const r = _mm256_loadu_pd(row + j);
+        __m256d const m = _mm256_loadu_pd(min + j);
+        __m256d const lt = _mm256_cmp_pd(r, m, _CMP_LT_OQ);
+
+        _mm256_storeu_pd(min + j, _mm256_blendv_pd(m, r, lt));
+        scatter(_mm256_movemask_pd(lt), j, i, imin);
+    }
+
+    column_min_scalar(row + j, n - j, i, min + j, imin + j);
+}
+
+__attribute__((target("avx2"))) void column_min_avx2(
+    std::int32_t const* row, int n, int i, std::int32_t* min, int* imin) {
+    int j = 0;
+
+    for (; j + 8 <= n; j += 8) {
+        __m256i const r = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(row + j));
+        __m256i const m = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(min + j));
+        __m256i const lt = _mm256_cmpgt_epi32(m, r);
+
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(min + j), _mm256_blendv_epi8(m, r, lt));
+        scatter(_mm256_movemask_ps(_mm256_castsi256_ps(lt)), j, i, imin);
+    }
+
+    column_min_scalar(row + j, n - j, i, min + j, imin + j);
+}
+
+#else
+
+bool const supported = false;
+
+#endif
+
+}  // namespace
+
+namespace simd {
+
+bool avx2() { return supported && !disabled; }
+
+void disable_avx2(bool disable) { disabled = disable; }
+
+#ifdef __x86_64__
+#    define DISPATCH(name, ...) \
+        return avx2() ? name##_avx2(__VA_ARGS__) : name##_scalar(__VA_ARGS__)
+#else
+#    define DISPATCH(name, ...) return name##_scalar(__VA_ARGS__)
+#endif
+
+Top2<double> top2(double const* c, double const* v, int n, double big) {
+    DISPATCH(top2, c, v, n, big);
+}
+
+Top2<std::int32_t> top2(std::int32_t const* c, std::int32_t const* v, int n, std::int32_t big) {
+    DISPATCH(top2, c, v, n, big);
+}
+
+void column_min(double const* row, int n, int i, double* min, int* imin) {
+    DISPATCH(column_min, row, n, i, min, imin);
+}
+
+void column_min(std::int32_t const* row, int n, int i, std::int32_t* min, int* imin) {
+    DISPATCH(column_min, row, n, i, min, imin);
+}
+
+#undef DISPATCH
+
+}  // namespace simd
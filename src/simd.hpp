@@ -0,0 +1,41 @@
+// Copyright (C) 2020 Conor Williams
+
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <cstdint>
+
+/*
+ *  Vectorised scans for the dense solvers, for double and int32_t costs. Each has a scalar version
+ *  and an AVX2 version chosen at run time if the CPU supports it. Both versions compute exactly the
+ *  same values in the same order (no FMA, no reassociation) hence give identical results, in
+ *  particular ties are always broken by the lowest index.
+ */
+namespace simd {
+
+// True if the AVX2 versions are in use
+bool avx2();
+
+// Use the scalar versions even if the CPU supports AVX2, e.g. for comparison
+void disable_avx2(bool disable = true);
+
+// The smallest h at j1 and the next smallest at j2 (the lowest such indices), m1 <= m2
+template <typename T> struct Top2 {
+    T m1;
+    int j1;
+    T m2;
+    int j2;
+};
+
+// Over h = c[j] - v[j] for j in [0, n), n >= 1, as lap() does: m2 is at most big, (big, 0) if unset
+Top2<double> top2(double const* c, double const* v, int n, double big);
+Top2<std::int32_t> top2(std::int32_t const* c, std::int32_t const* v, int n, std::int32_t big);
+
+// For j in [0, n) if row[j] < min[j] set (min[j], imin[j]) = (row[j], i)
+void column_min(double const* row, int n, int i, double* min, int* imin);
+void column_min(std::int32_t const* row, int n, int i, std::int32_t* min, int* imin);
+
+}  // namespace simd
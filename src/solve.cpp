@@ -0,0 +1,590 @@
+// Copyright (C) 2020 Conor Williams
+
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include "solve.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <optional>
+#include <stdexcept>
+#include <vector>
+
+#include "auction.hpp"
+#include "ballot.hpp"
+#include "certificate.hpp"
+#include "cohort.hpp"
+#include "cost.hpp"
+#include "jv.hpp"
+#include "lapjv.hpp"
+#include "parallel.hpp"
+#include "presolve.hpp"
+#include "sparse.hpp"
+
+namespace {  // Like static
+
+// Rooms with capacity > 1 are duplicated, room r occupies columns [start[r], start[r + 1])
+struct Slots {
+    explicit Slots(Cohort const& c) {
+        for (std::uint32_t r = 0; r < c.num_rooms(); r++) {
+            room.insert(room.end(), c.capacity[r], r);
+            start.push_back(room.size());
+        }
+    }
+
+    std::vector<std::size_t> start{0};
+    std::vector<std::uint32_t> room{};
+};
+
+// Write person i's costs, in the units of T, for every slot followed by the kick columns
+template <typename T>
+void fill_person(
+    Cohort const& c, CostTable const& t, Slots const& s, std::size_t i, T* row, int cols) {
+    std::size_t const m = s.room.size();
+
+    std::fill(row, row + m, to_units<T>(t.big_num()));
+
+    for (std::size_t e = c.row_start[i]; e < c.row_start[i + 1]; e++) {
+        std::uint32_t r = c.room[e];
+        T const x = to_units<T>(t.choice(i, c.rank[e], c.hostel[r]));
+        std::fill(row + s.start[r], row + s.start[r + 1], x);
+    }
+
+    std::fill(row + m, row + cols, to_units<T>(t.kick_cost()));
+}
+
+// Make each person's potential tight with their allocation
+void tighten(Cohort const& c, CostTable const& t, Solution& sol) {
+    sol.u.resize(c.num_people());
+
+    for (std::uint32_t i = 0; i < c.num_people(); i++) {
+        if (std::optional r = sol.allocation[i]) {
+            sol.u[i] = t(c, i, r) - sol.v[*r];
+        } else {
+            sol.u[i] = t.kick_cost();
+        }
+    }
+}
+
+/*
+ *  Read the allocation of the first n rows out of the arena and map the potentials of the cols
+ *  dense columns onto the compact problem. Shifting every column by the largest potential makes the
+ *  free columns (including all those held by null people) zero and the rest negative. A room takes
+ *  the largest potential of its slots, which can only lower the potential of its occupants.
+ */
+template <typename T>
+Solution read_arena(BasicLapArena<T>& arena,
+                    Cohort const& c,
+                    CostTable const& t,
+                    Slots const& s,
+                    std::size_t n,
+                    std::size_t cols) {
+    Solution sol;
+
+    for (std::size_t i = 0; i < n; i++) {
+        if (std::size_t j = arena.rowsol()[i]; j < s.room.size()) {
+            sol.allocation.emplace_back(s.room[j]);
+        } else {
+            sol.allocation.emplace_back(std::nullopt);
+        }
+    }
+
+    T const shift = cols ? *std::max_element(arena.v(), arena.v() + cols) : 0;
+
+    for (std::uint32_t r = 0; r < c.num_rooms(); r++) {
+        if (s.start[r] == s.start[r + 1]) {
+            sol.v.push_back(0);
+        } else {
+            auto first = arena.v() + s.start[r];
+            auto last = arena.v() + s.start[r + 1];
+            sol.v.push_back(from_units(*std::max_element(first, last) - shift));
+        }
+    }
+
+    tighten(c, t, sol);
+
+    return sol;
+}
+
+// Reused by repeated solves on this thread (sweeps, batch verification)
+thread_local LapArena arena;
+thread_local BasicLapArena<std::int32_t> fixed_arena;  // For the integer mode
+
+// Shortest path searches and the columns they scanned, summed over components
+void record(Profile* profile, std::size_t paths, std::size_t scans) {
+    if (profile) {
+        profile->count("paths", paths);
+        profile->count("scans", scans);
+    }
+}
+
+/*
+ *  The classic lap() only takes doubles, in the integer mode the table's costs are on the
+ *  fixed-point grid so its arithmetic is exact anyway. It does not expose its iteration counts,
+ *  only the size of the problem is recorded.
+ */
+Solution solve_lapjv(Cohort const& c, CostTable const& t, std::size_t threads, Profile* profile) {
+    std::size_t const n = c.num_people();
+
+    Slots const s{c};
+
+    // Rows are people followed by null people and columns are rooms followed by kicks. For every
+    // real person we need the possibility of them being kicked off the ballot and must pad people
+    // (always more than rooms) with null people for balanced assignment.
+    int const dim = n + s.room.size();
+
+    auto fill = [&](std::size_t i, cost* row) {
+        if (i < n) {
+            fill_person(c, t, s, i, row, dim);
+        } else {
+            std::fill(row, row + dim, 0.0);
+        }
+    };
+
+    double const matrix = seconds([&] { fill_rows(dim, dim, fill, arena, threads); });
+
+    lap(dim, arena.rows(), arena.rowsol(), arena.colsol(), arena.u(), arena.v());
+
+    if (profile) {
+        profile->time("matrix", matrix);
+        profile->count("lap_dim", dim);
+    }
+
+    return read_arena(arena, c, t, s, n, dim);
+}
+
+// As above using the port of lap() in jv.hpp, in the integer mode on int32_t costs
+template <typename T>
+Solution solve_jv(Cohort const& c,
+                  CostTable const& t,
+                  std::size_t threads,
+                  Profile* profile,
+                  BasicLapArena<T>& arena) {
+    std::size_t const n = c.num_people();
+
+    Slots const s{c};
+
+    int const dim = n + s.room.size();
+
+    auto fill = [&](std::size_t i, T* row) {
+        if (i < n) {
+            fill_person(c, t, s, i, row, dim);
+        } else {
+            std::fill(row, row + dim, 0);
+        }
+    };
+
+    double const matrix = seconds([&] { fill_rows(dim, dim, fill, arena, threads); });
+
+    lap_jv(dim, arena, threads);
+
+    if (profile) {
+        profile->time("matrix", matrix);
+        profile->count("lap_dim", dim);
+        profile->count("scans", arena.scans());
+    }
+
+    return read_arena(arena, c, t, s, n, dim);
+}
+
+// As solve_lapjv but unbalanced (people x (rooms + kicks)), the null people are never built
+template <typename T>
+Solution solve_dense(Cohort const& c,
+                     CostTable const& t,
+                     std::size_t threads,
+                     Profile* profile,
+                     BasicLapArena<T>& arena) {
+    std::size_t const n = c.num_people();
+
+    Slots const s{c};
+
+    int const cols = n + s.room.size();
+
+    auto fill = [&](std::size_t i, T* row) { fill_person(c, t, s, i, row, cols); };
+
+    double const matrix = seconds([&] { fill_rows(n, cols, fill, arena, threads); });
+
+    lap_rect(n, cols, arena);
+
+    if (profile) {
+        profile->time("matrix", matrix);
+    }
+
+    record(profile, n, arena.scans());
+
+    return read_arena(arena, c, t, s, n, cols);
+}
+
+// The preference edges as a transportation problem with a single kick sink, in the units of T
+template <typename T = double> SparseCost<T> sparse_cost(Cohort const& c, CostTable const& t) {
+    SparseCost<T> sc;
+
+    sc.cols = c.num_rooms();
+    sc.capacity = c.capacity;
+
+    for (std::uint32_t i = 0; i < c.num_people(); i++) {
+        for (std::size_t e = c.row_start[i]; e < c.row_start[i + 1]; e++) {
+            sc.push_edge(c.room[e], to_units<T>(t.choice(i, c.rank[e], c.hostel[c.room[e]])));
+        }
+        sc.push_row(to_units<T>(t.kick_cost()));
+    }
+
+    return sc;
+}
+
+// Room id allocated to each of the first n rows
+template <typename T> Allocation read_sparse(SparseAssignment<T> const& solver, std::size_t n) {
+    Allocation allocation;
+
+    for (std::size_t i = 0; i < n; i++) {
+        if (std::uint32_t j = solver.rowsol(i); j != solver.kicked) {
+            allocation.emplace_back(j);
+        } else {
+            allocation.emplace_back(std::nullopt);
+        }
+    }
+
+    return allocation;
+}
+
+// Allocation and duals of a finished sparse solve
+template <typename T>
+Solution read_solution(Cohort const& c, CostTable const& t, SparseAssignment<T> const& solver) {
+    Solution sol;
+
+    sol.allocation = read_sparse(solver, c.num_people());
+
+    for (std::size_t r = 0; r < c.num_rooms(); r++) {
+        sol.v.push_back(from_units(solver.v(r)));
+    }
+
+    tighten(c, t, sol);
+
+    return sol;
+}
+
+// Solve as a transportation problem using only the preference edges
+template <typename T> Solution solve_sparse(Cohort const& c, CostTable const& t, Profile* profile) {
+    SparseCost<T> const sc = sparse_cost<T>(c, t);
+
+    SparseAssignment solver{sc};
+
+    solver.solve();
+
+    record(profile, solver.paths(), solver.scans());
+
+    return read_solution(c, t, solver);
+}
+
+/*
+ *  The auction runs on the costs rounded to the finest power of two grid, 2^-bits, on which its 64
+ *  bit prices cannot overflow. Its prices are then complementary slack to within the rounding plus
+ *  1 / scale() units of the grid, so warm starting the sparse solver from them with a tolerance of
+ *  two units keeps the rows. Rooms left with spare capacity but a price are then refilled, and any
+ *  rows this displaces re-inserted, along shortest paths. The result is checked against the table,
+ *  should the certificate fail (the grid is too coarse for its tolerance) the sparse solver starts
+ *  over.
+ */
+Solution solve_auction(Cohort const& c, CostTable const& t, std::size_t threads, Profile* profile) {
+    SparseCost<double> const sc = sparse_cost(c, t);
+
+    double top = 1;
+
+    for (double x : sc.cost) {
+        top = std::max(top, std::abs(x));
+    }
+
+    for (double x : sc.kick) {
+        top = std::max(top, std::abs(x));
+    }
+
+    // Leaves a factor of four for the prices and the sums of scaled costs and prices
+    int const bits = std::clamp(60 - std::ilogb(top) - std::ilogb(sc.rows() + 1.0) - 2, 0, 50);
+
+    SparseCost<std::int64_t> fixed;
+
+    fixed.cols = sc.cols;
+    fixed.capacity = sc.capacity;
+    fixed.row_start = sc.row_start;
+    fixed.col = sc.col;
+
+    for (double x : sc.cost) {
+        fixed.cost.push_back(std::llround(std::ldexp(x, bits)));
+    }
+
+    for (double x : sc.kick) {
+        fixed.kick.push_back(std::llround(std::ldexp(x, bits)));
+    }
+
+    Auction auction{fixed, threads};
+
+    auction.solve();
+
+    if (profile) {
+        profile->count("auction_phases", auction.phases());
+        profile->count("auction_rounds", auction.rounds());
+        profile->count("auction_bids", auction.bids());
+    }
+
+    std::vector<std::uint32_t> rowsol;
+    std::vector<double> v;
+
+    for (std::size_t i = 0; i < c.num_people(); i++) {
+        rowsol.push_back(auction.rowsol(i));
+    }
+
+    for (std::size_t r = 0; r < c.num_rooms(); r++) {
+        v.push_back(-std::ldexp(auction.price(r), -bits) / auction.scale());
+    }
+
+    SparseAssignment solver{sc};
+
+    for (std::size_t i : solver.warm_start(rowsol, v, std::ldexp(2.0, -bits))) {
+        solver.augment(i);
+    }
+
+    record(profile, solver.paths(), solver.scans());
+
+    Solution sol = read_solution(c, t, solver);
+
+    try {
+        check_certificate(c, t, sol);
+    } catch (std::runtime_error const& err) {
+        std::cout << "-- Auction not exact (" << err.what() << "), solving again\n";
+        return solve_sparse<double>(c, t, profile);
+    }
+
+    return sol;
+}
+
+Solution solve_whole(Cohort const& c, CostTable const& t, SolveOptions const& opt) {
+    switch (opt.solver) {
+        case Solver::sparse:
+            if (t.fixed_point()) {
+                return solve_sparse<std::int32_t>(c, t, opt.profile);
+            }
+            return solve_sparse<double>(c, t, opt.profile);
+        case Solver::dense:
+            if (t.fixed_point()) {
+                return solve_dense(c, t, opt.threads, opt.profile, fixed_arena);
+            }
+            return solve_dense(c, t, opt.threads, opt.profile, arena);
+        case Solver::jv:
+            if (t.fixed_point()) {
+                return solve_jv(c, t, opt.threads, opt.profile, fixed_arena);
+            }
+            return solve_jv(c, t, opt.threads, opt.profile, arena);
+        case Solver::auction:
+            return solve_auction(c, t, opt.threads, opt.profile);
+        case Solver::lapjv:
+        default:
+            return solve_lapjv(c, t, opt.threads, opt.profile);
+    }
+}
+
+/*
+ *  People only compete with people in the same connected component of the choice graph, hence the
+ *  components can be solved independently and their solutions (and duals) concatenated. Each
+ *  component is solved on one thread, largest first, so the results do not depend on the number of
+ *  threads.
+ */
+Solution solve_components(Cohort const& c, CostTable const& t, SolveOptions const& opt) {
+    Components const comp = components(c);
+
+    if (comp.count <= 1) {
+        return solve_whole(c, t, opt);
+    }
+
+    std::vector<std::vector<std::uint32_t>> people(comp.count);
+    std::vector<std::vector<std::uint32_t>> rooms(comp.count);
+
+    for (std::uint32_t i = 0; i < c.num_people(); i++) {
+        people[comp.person[i]].push_back(i);
+    }
+
+    for (std::uint32_t r = 0; r < c.num_rooms(); r++) {
+        rooms[comp.room[r]].push_back(r);
+    }
+
+    std::vector<std::size_t> order(comp.count);
+
+    for (std::size_t k = 0; k < comp.count; k++) {
+        order[k] = k;
+    }
+
+    std::stable_sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) {
+        return people[a].size() + rooms[a].size() > people[b].size() + rooms[b].size();
+    });
+
+    SolveOptions sub_opt = opt;
+
+    sub_opt.threads = 1;
+    sub_opt.components = false;
+
+    std::vector<Solution> sub(comp.count);
+
+    parallel_tasks(comp.count, opt.threads, [&](std::size_t task) {
+        std::size_t const k = order[task];
+
+        sub[k] = solve_whole(sub_cohort(c, people[k], rooms[k]), t.select(people[k]), sub_opt);
+    });
+
+    // Merge back into the ids of the whole cohort
+    Solution sol;
+
+    sol.allocation.resize(c.num_people());
+    sol.u.resize(c.num_people());
+    sol.v.resize(c.num_rooms());
+
+    for (std::size_t k = 0; k < comp.count; k++) {
+        for (std::size_t i = 0; i < people[k].size(); i++) {
+            if (std::optional r = sub[k].allocation[i]) {
+                sol.allocation[people[k][i]] = rooms[k][*r];
+            }
+            sol.u[people[k][i]] = sub[k].u[i];
+        }
+
+        for (std::size_t r = 0; r < rooms[k].size(); r++) {
+            sol.v[rooms[k][r]] = sub[k].v[r];
+        }
+    }
+
+    return sol;
+}
+
+}  // namespace
+
+char const* solver_name(Solver solver) {
+    switch (solver) {
+        case Solver::sparse:
+            return "sparse";
+        case Solver::dense:
+            return "dense";
+        case Solver::jv:
+            return "jv";
+        case Solver::auction:
+            return "auction";
+        case Solver::lapjv:
+        default:
+            return "lapjv";
+    }
+}
+
+Solution solve(Cohort const& c, CostTable const& t, SolveOptions const& opt) {
+    if (opt.presolve) {
+        Presolved const p = presolve(c, t);
+
+        std::cout << "-- Presolve " << p << '\n';
+
+        if (opt.profile) {
+            opt.profile->count("presolve_fixed", c.num_people() - p.cohort.num_people());
+        }
+
+        SolveOptions sub_opt = opt;
+
+        sub_opt.presolve = false;
+
+        if (p.cohort.num_people() == 0) {
+            return p.expand(c, t, {});
+        }
+
+        return p.expand(c, t, solve(p.cohort, p.table, sub_opt));
+    }
+
+    return opt.components ? solve_components(c, t, opt) : solve_whole(c, t, opt);
+}
+
+void solve_prefixes(Cohort const& c,
+                    CostTable const& t,
+                    std::size_t first,
+                    std::size_t last,
+                    std::function<void(std::size_t, Allocation const&)> const& f) {
+    last = std::min(last, c.num_people());
+
+    SparseCost<double> const sc = sparse_cost(c, t);
+
+    SparseAssignment solver{sc};
+
+    // Rows are independent until inserted, any prefix of insertions is an optimal solve of it
+    for (std::size_t n = 0; n <= last; n++) {
+        if (n >= first) {
+            f(n, read_sparse(solver, n));
+        }
+        if (n < last) {
+            solver.augment(n);
+        }
+    }
+}
+
+Solution repair(Cohort const& c,
+                CostTable const& t,
+                Allocation const& previous,
+                std::vector<bool> const& known,
+                std::vector<double> const& v,
+                std::size_t& augmentations) {
+    SparseCost<double> const sc = sparse_cost(c, t);
+
+    SparseAssignment solver{sc};
+
+    std::vector<std::uint32_t> rowsol;
+
+    for (std::size_t i = 0; i < c.num_people(); i++) {
+        if (!known[i]) {
+            rowsol.push_back(solver.unassigned);
+        } else {
+            rowsol.push_back(previous[i].value_or(solver.kicked));
+        }
+    }
+
+    // Allow for the round-off in the potentials of whichever backend produced them
+    std::vector rows = solver.warm_start(rowsol, v, 1e-12);
+
+    for (std::size_t i : rows) {
+        solver.augment(i);
+    }
+
+    augmentations = rows.size();
+
+    return read_solution(c, t, solver);
+}
+
+RowUpdate::RowUpdate(Cohort const& c, CostTable const& t, Solution const& sol)
+    : m_c(c), m_sc(sparse_cost(c, t)), m_v(sol.v) {
+    for (std::optional r : sol.allocation) {
+        m_rowsol.push_back(r.value_or(SparseAssignment<>::kicked));
+    }
+}
+
+Allocation RowUpdate::update(std::uint32_t i, std::vector<double> const& costs) {
+    std::size_t const first = m_sc.row_start[i];
+    std::size_t const last = m_sc.row_start[i + 1];
+
+    std::vector<double> const saved(m_sc.cost.begin() + first, m_sc.cost.begin() + last);
+
+    for (std::size_t e = first; e < last; e++) {
+        m_sc.cost[e] = costs[m_c.rank[e]];
+    }
+
+    std::uint32_t const was = m_rowsol[i];
+
+    m_rowsol[i] = SparseAssignment<>::unassigned;
+
+    SparseAssignment solver{m_sc};
+
+    // Allow for the round-off in the potentials of whichever backend produced them
+    for (std::size_t r : solver.warm_start(m_rowsol, m_v, 1e-12)) {
+        solver.augment(r);
+    }
+
+    m_rowsol[i] = was;
+
+    std::copy(saved.begin(), saved.end(), m_sc.cost.begin() + first);
+
+    return read_sparse(solver, m_c.num_people());
+}
+
@@ -0,0 +1,95 @@
+// Copyright (C) 2020 Conor Williams
+
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <vector>
+
+#include "ballot.hpp"
+#include "cohort.hpp"
+#include "cost.hpp"
+#include "profile.hpp"
+#include "sparse.hpp"
+
+// Room id allocated to each person in a cohort, nullopt if they were kicked
+using Allocation = std::vector<std::optional<std::uint32_t>>;
+
+/*
+ *  An allocation and the dual potentials proving it optimal. The duals are those of the compact
+ *  problem: people x (rooms + one uncapacitated kick option, with potential zero). For an optimal
+ *  allocation v[r] <= 0, v[r] == 0 for rooms with spare capacity and u[i] + v[r] <= cost(i, r) with
+ *  equality for the room (or kick) person i was allocated. See check_certificate.
+ */
+struct Solution {
+    Allocation allocation{};
+    std::vector<double> u{};  // Person id -> potential
+    std::vector<double> v{};  // Room id -> potential
+
+    template <class Archive> void serialize(Archive& archive) { archive(allocation, u, v); }
+};
+
+struct SolveOptions {
+    Solver solver = Solver::lapjv;
+    std::size_t threads = 1;     // Zero for all hardware threads
+    bool components = false;     // Solve connected components independently, in parallel
+    bool presolve = false;       // Fix the people every optimum agrees on first, see presolve.hpp
+    Profile* profile = nullptr;  // If set, the solvers add their counters to it
+};
+
+char const* solver_name(Solver);
+
+// Find the minimum cost allocation of the cohort, and its duals, using the chosen backend
+Solution solve(Cohort const&, CostTable const&, SolveOptions const&);
+
+/*
+ *  Solve the cohorts made of the first n people of the cohort for every n in [first, last], calling
+ *  f(n, allocation of the first n people) in increasing n. Uses the sparse solver warm started from
+ *  the previous n, such that each step is a single augmenting path.
+ */
+void solve_prefixes(Cohort const&,
+                    CostTable const&,
+                    std::size_t first,
+                    std::size_t last,
+                    std::function<void(std::size_t, Allocation const&)> const& f);
+
+/*
+ *  Re-optimise after people are added to or removed from a cohort, warm started from the previous
+ *  allocation and room potentials (in the ids of this cohort, zero for new rooms). People for
+ *  whom known[i] is false are new to the cohort and their previous allocation is ignored. Only the
+ *  people new or displaced by the change are re-inserted, with one augmenting path each, the
+ *  number of which is written to augmentations. Uses the sparse solver.
+ */
+Solution repair(Cohort const&,
+                CostTable const&,
+                Allocation const& previous,
+                std::vector<bool> const& known,
+                std::vector<double> const& v,
+                std::size_t& augmentations);
+
+/*
+ *  Re-optimises a solution after the costs of a single person change, e.g. for counterfactuals.
+ *  Each update warm starts the sparse solver from the solution with that person removed, so only
+ *  the hole they leave and their own insertion are searched for. The solution and the cost table
+ *  are left untouched, hence any number of updates can be made from one. Not thread safe, use one
+ *  per thread.
+ */
+class RowUpdate {
+  public:
+    RowUpdate(Cohort const&, CostTable const&, Solution const&);
+
+    // Optimal allocation with the cost of person i's choice of each rank replaced by costs[rank]
+    [[nodiscard]] Allocation update(std::uint32_t i, std::vector<double> const& costs);
+
+  private:
+    Cohort const& m_c;
+    SparseCost<double> m_sc;
+    std::vector<std::uint32_t> m_rowsol;
+    std::vector<double> m_v;
+};
@@ -0,0 +1,488 @@
+// Copyright (C) 2020 Conor Williams
+
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/*
+ *  Sparse (CSR) cost structure: row i may only be assigned to the columns in its edge list or to
+ *  the implicit "kick" sink, which has unlimited capacity. Column j may take up to capacity[j] rows
+ *  (one if capacity is empty). Every other cell of the equivalent dense matrix is never
+ *  materialised.
+ */
+template <typename T = double> struct SparseCost {
+    std::size_t cols = 0;
+
+    std::vector<std::uint32_t> capacity{};  // Optional, rows each column can take
+
+    std::vector<std::size_t> row_start{0};  // Edges of row i are [row_start[i], row_start[i + 1])
+    std::vector<std::uint32_t> col{};       // Column of each edge
+    std::vector<T> cost{};                  // Cost of each edge
+    std::vector<T> kick{};                  // Cost of kicking each row
+
+    [[nodiscard]] std::size_t rows() const { return kick.size(); }
+
+    // Append an edge to the row currently being built
+    void push_edge(std::uint32_t j, T c) {
+        col.push_back(j);
+        cost.push_back(c);
+    }
+
+    // Finish the row currently being built
+    void push_row(T kick_cost) {
+        kick.push_back(kick_cost);
+        row_start.push_back(col.size());
+    }
+};
+
+/*
+ *  Successive shortest augmenting path solver for the transportation problem defined by a
+ *  SparseCost, i.e. min-cost flow from rows (supply one) through the edges into the columns and the
+ *  kick sink. Rows are inserted one at a time, each insertion runs Dijkstra over the columns
+ *  reachable through the current assignment using the column potentials v, so only the touched
+ *  edges are ever scanned. Finds the global (but possibly degenerate) minimum of:
+ *
+ *      sum_i c(i, rowsol(i))
+ *
+ *  such that each column is used at most capacity times. On termination v[j] <= 0 for all columns,
+ *  v[j] == 0 for all columns with spare capacity and the kick sink has potential zero.
+ */
+template <typename T = double> class SparseAssignment {
+  public:
+    static constexpr std::uint32_t kicked = std::numeric_limits<std::uint32_t>::max();
+    static constexpr std::uint32_t unassigned = kicked - 1;
+
+    explicit SparseAssignment(SparseCost<T> const &c)
+        : m_c(c),
+          m_rowsol(c.rows(), unassigned),
+          m_rowcost(c.rows(), 0),
+          m_rowslot(c.rows(), 0),
+          m_slot_start(c.cols + 1, 0),
+          m_load(c.cols, 0),
+          m_v(c.cols + 1, 0),
+          m_d(c.cols + 1, inf),
+          m_pred(c.cols + 1),
+          m_done(c.cols + 1, false),
+          m_from(c.cols + 1) {
+        if (!c.capacity.empty() && c.capacity.size() != c.cols) {
+            throw std::invalid_argument("Need a capacity for every column");
+        }
+
+        for (std::size_t j = 0; j < c.cols; j++) {
+            m_slot_start[j + 1] = m_slot_start[j] + (c.capacity.empty() ? 1 : c.capacity[j]);
+        }
+
+        m_slots.resize(m_slot_start.back());
+    }
+
+    // Assign every row, returns the total cost
+    auto solve() {
+        for (std::size_t i = 0; i < m_c.rows(); i++) {
+            augment(i);
+        }
+        return total();
+    }
+
+    // Insert the (currently unassigned) row i, re-optimising along one shortest augmenting path
+    void augment(std::size_t i) {
+        if (m_rowsol[i] != unassigned) {
+            throw std::invalid_argument("Row is already assigned");
+        }
+
+        std::size_t const kick = m_c.cols;
+
+        relax(i, 0);
+
+        std::uint32_t sink = 0;
+        T dmin = 0;
+
+        while (true) {
+            std::pop_heap(m_heap.begin(), m_heap.end(), std::greater<>{});
+            auto [dist, j] = m_heap.back();
+            m_heap.pop_back();
+
+            if (m_done[j] || dist > m_d[j]) {
+                continue;  // Stale heap entry
+            }
+
+            m_done[j] = true;
+            m_scanned.push_back(j);
+
+            if (j == kick || m_load[j] < capacity(j)) {
+                sink = j;
+                dmin = dist;
+                break;
+            }
+
+            for (std::uint32_t s = m_slot_start[j]; s < m_slot_start[j] + m_load[j]; s++) {
+                std::uint32_t r = m_slots[s];
+                relax(r, dist - (m_rowcost[r] - m_v[j]));
+            }
+        }
+
+        m_paths += 1;
+        m_scans += m_scanned.size();
+
+        // Update potentials of the columns that were closer than the sink
+        for (std::uint32_t j : m_scanned) {
+            if (j != sink) {
+                m_v[j] += m_d[j] - dmin;
+            }
+        }
+
+        // Move rows along the path, each intermediate column swaps one row for another
+        for (std::uint32_t j = sink;;) {
+            auto [r, c] = m_pred[j];
+            std::uint32_t prev = m_rowsol[r];
+
+            if (prev < kick) {
+                unload(r);
+            }
+
+            m_rowsol[r] = j == kick ? kicked : j;
+            m_rowcost[r] = c;
+
+            if (j != kick) {
+                load(r, j);
+            }
+
+            if (r == i) {
+                break;
+            }
+
+            j = prev;
+        }
+
+        // Reset only what was touched
+        for (std::uint32_t j : m_touched) {
+            m_d[j] = inf;
+            m_done[j] = false;
+        }
+        m_touched.clear();
+        m_scanned.clear();
+        m_heap.clear();
+    }
+
+    /*
+     *  Start from the assignment (a column, kicked or unassigned per row) and column potentials
+     *  of a closely related problem, e.g. the solution before some rows were added or removed,
+     *  instead of from empty. Rows whose assignment is over capacity or not dual feasible under v
+     *  are dropped. Every column then left with spare capacity but a negative potential is
+     *  refilled along a shortest path (see fill). Returns the unassigned rows, after augment() of
+     *  each the assignment is optimal. Reduced costs down to -tol are taken as zero, to absorb the
+     *  round-off in potentials that were stored.
+     */
+    std::vector<std::size_t> warm_start(std::vector<std::uint32_t> const &rowsol,
+                                        std::vector<T> const &v,
+                                        T tol = 0) {
+        if (rowsol.size() != m_c.rows() || v.size() != m_c.cols) {
+            throw std::invalid_argument(
+                "Need an assignment for every row and a potential per column");
+        }
+
+        // Potentials within round-off of zero are zero
+        for (std::size_t j = 0; j < m_c.cols; j++) {
+            m_v[j] = v[j] < -tol ? v[j] : 0;
+        }
+
+        for (std::size_t i = 0; i < m_c.rows(); i++) {
+            if (m_rowsol[i] != unassigned) {
+                throw std::invalid_argument("Can only warm start before augmenting");
+            }
+
+            std::uint32_t const j = rowsol[i];
+            std::optional<T> c;
+
+            if (j == kicked) {
+                c = m_c.kick[i];
+            } else if (j < m_c.cols && m_load[j] < capacity(j)) {
+                for (std::size_t e = m_c.row_start[i]; e < m_c.row_start[i + 1]; e++) {
+                    if (m_c.col[e] == j) {
+                        c = m_c.cost[e];
+                    }
+                }
+            }
+
+            if (c && feasible(i, *c - potential(j) - tol)) {
+                m_rowsol[i] = j;
+                m_rowcost[i] = *c;
+
+                if (j != kicked) {
+                    load(i, j);
+                }
+            }
+        }
+
+        // Rows with an edge into each column, as (row, cost)
+        m_into_start.assign(m_c.cols + 1, 0);
+        m_into.resize(m_c.col.size());
+
+        for (std::uint32_t j : m_c.col) {
+            ++m_into_start[j + 1];
+        }
+
+        for (std::size_t j = 0; j < m_c.cols; j++) {
+            m_into_start[j + 1] += m_into_start[j];
+        }
+
+        std::vector<std::size_t> next(m_into_start.begin(), m_into_start.end() - 1);
+
+        for (std::uint32_t i = 0; i < m_c.rows(); i++) {
+            for (std::size_t e = m_c.row_start[i]; e < m_c.row_start[i + 1]; e++) {
+                m_into[next[m_c.col[e]]++] = {i, m_c.cost[e]};
+            }
+        }
+
+        // Columns that can take no one only need to be priced out of reach
+        for (std::uint32_t j = 0; j < m_c.cols; j++) {
+            if (capacity(j) == 0) {
+                for (std::size_t e = m_into_start[j]; e < m_into_start[j + 1]; e++) {
+                    if (auto [r, c] = m_into[e]; m_rowsol[r] != unassigned) {
+                        m_v[j] = std::min(m_v[j], c - (m_rowcost[r] - potential(m_rowsol[r])));
+                    }
+                }
+            }
+        }
+
+        for (std::uint32_t j = 0; j < m_c.cols; j++) {
+            while (m_load[j] < capacity(j) && m_v[j] < 0) {
+                fill(j);
+            }
+        }
+
+        std::vector<std::size_t> free;
+
+        for (std::size_t i = 0; i < m_c.rows(); i++) {
+            if (m_rowsol[i] == unassigned) {
+                free.push_back(i);
+            }
+        }
+
+        return free;
+    }
+
+    // Column assigned to row i or SparseAssignment::kicked
+    [[nodiscard]] std::uint32_t rowsol(std::size_t i) const { return m_rowsol[i]; }
+
+    // Cost of row i's current assignment
+    [[nodiscard]] T rowcost(std::size_t i) const { return m_rowcost[i]; }
+
+    // Column potentials
+    [[nodiscard]] T v(std::size_t j) const { return m_v[j]; }
+
+    // Number of shortest path searches (by augment or fill) so far
+    [[nodiscard]] std::size_t paths() const { return m_paths; }
+
+    // Number of columns scanned by all the searches so far
+    [[nodiscard]] std::size_t scans() const { return m_scans; }
+
+    // Integer costs are summed in 64 bits
+    [[nodiscard]] auto total() const {
+        std::conditional_t<std::is_integral_v<T>, std::int64_t, T> sum = 0;
+        for (T c : m_rowcost) {
+            sum += c;
+        }
+        return sum;
+    }
+
+  private:
+    static constexpr T inf = std::numeric_limits<T>::max();
+
+    SparseCost<T> const &m_c;
+
+    std::vector<std::uint32_t> m_rowsol;
+    std::vector<T> m_rowcost;
+    std::vector<std::uint32_t> m_rowslot;  // Index of row in m_slots
+
+    // Rows assigned to column j are m_slots[m_slot_start[j], m_slot_start[j] + m_load[j])
+    std::vector<std::uint32_t> m_slot_start;
+    std::vector<std::uint32_t> m_load;
+    std::vector<std::uint32_t> m_slots{};
+
+    std::vector<T> m_v;  // Last element is the kick sink, always zero
+
+    // Rows with an edge into column j are m_into[m_into_start[j], m_into_start[j + 1]), built by
+    // warm_start as (row, edge cost)
+    std::vector<std::size_t> m_into_start{};
+    std::vector<std::pair<std::uint32_t, T>> m_into{};
+
+    // Dijkstra workspace, reused between augmentations
+    std::vector<T> m_d;
+    std::vector<std::pair<std::uint32_t, T>> m_pred;  // (row, edge cost) that reached column
+    std::vector<bool> m_done;
+    std::vector<std::uint32_t> m_touched;
+    std::vector<std::uint32_t> m_scanned;
+    std::vector<std::uint32_t> m_from;  // Column the predecessor row moves into, for fill
+
+    std::vector<std::pair<T, std::uint32_t>> m_heap;  // Min-heap, ties broken by lowest column
+
+    std::size_t m_paths = 0;
+    std::size_t m_scans = 0;
+
+    [[nodiscard]] std::uint32_t capacity(std::size_t j) const {
+        return m_c.capacity.empty() ? 1 : m_c.capacity[j];
+    }
+
+    void load(std::uint32_t r, std::uint32_t j) {
+        m_rowslot[r] = m_slot_start[j] + m_load[j]++;
+        m_slots[m_rowslot[r]] = r;
+    }
+
+    // Remove row r from its column, moving the column's last row into the hole
+    void unload(std::uint32_t r) {
+        std::uint32_t j = m_rowsol[r];
+        std::uint32_t last = m_slots[m_slot_start[j] + --m_load[j]];
+
+        m_slots[m_rowslot[r]] = last;
+        m_rowslot[last] = m_rowslot[r];
+    }
+
+    /*
+     *  Column j has spare capacity but a negative potential, i.e. rows would like to move into it.
+     *  The reverse of augment: Dijkstra from j over the columns a hole can be moved to, by a row
+     *  with an edge into the hole leaving its column. The search ends at the first of: a kicked row
+     *  filling the hole or the hole staying in column k (after raising v[k] to zero), reached at
+     *  reduced distance d[k] - v[k]. Raising the potentials of the scanned columns keeps the
+     *  reduced costs non-negative and the path tight. The kick node stands for both endings.
+     */
+    void fill(std::uint32_t j) {
+        std::uint32_t const kick = m_c.cols;
+
+        offer(j, unassigned, 0, 0);
+
+        T dmin = 0;
+
+        while (true) {
+            std::pop_heap(m_heap.begin(), m_heap.end(), std::greater<>{});
+            auto [dist, k] = m_heap.back();
+            m_heap.pop_back();
+
+            if (m_done[k] || dist > m_d[k]) {
+                continue;  // Stale heap entry
+            }
+
+            m_done[k] = true;
+
+            if (k == kick) {
+                dmin = dist;
+                break;
+            }
+
+            m_scanned.push_back(k);
+
+            // Leave the hole here
+            if (offer(kick, unassigned, 0, dist - m_v[k])) {
+                m_from[kick] = k;
+            }
+
+            for (std::size_t e = m_into_start[k]; e < m_into_start[k + 1]; e++) {
+                auto [r, c] = m_into[e];
+                std::uint32_t const at = m_rowsol[r];
+
+                if (at == unassigned || at == k) {
+                    continue;
+                }
+
+                T const reduced = c - (m_rowcost[r] - potential(at)) - m_v[k];
+
+                if (offer(at == kicked ? kick : at, r, c, dist + reduced)) {
+                    m_from[at == kicked ? kick : at] = k;
+                }
+            }
+        }
+
+        m_paths += 1;
+        m_scans += m_scanned.size();
+
+        for (std::uint32_t k : m_scanned) {
+            m_v[k] += dmin - m_d[k];
+        }
+
+        // Rows move into the hole left by the next, starting from the end of the path
+        std::vector<std::tuple<std::uint32_t, std::uint32_t, T>> moves;
+
+        auto [r, c] = m_pred[kick];
+        std::uint32_t k = m_from[kick];
+
+        if (r != unassigned) {
+            moves.emplace_back(r, k, c);
+        }
+
+        while (k != j) {
+            auto [r, c] = m_pred[k];
+            moves.emplace_back(r, m_from[k], c);
+            k = m_from[k];
+        }
+
+        for (auto it = moves.rbegin(); it != moves.rend(); ++it) {
+            auto [r, to, c] = *it;
+
+            if (m_rowsol[r] != kicked) {
+                unload(r);
+            }
+
+            m_rowsol[r] = to;
+            m_rowcost[r] = c;
+            load(r, to);
+        }
+
+        for (std::uint32_t k : m_touched) {
+            m_d[k] = inf;
+            m_done[k] = false;
+        }
+        m_touched.clear();
+        m_scanned.clear();
+        m_heap.clear();
+    }
+
+    // Potential of column j, the kick sink's is zero
+    [[nodiscard]] T potential(std::uint32_t j) const { return j == kicked ? 0 : m_v[j]; }
+
+    // True if no edge of row i (nor kicking it) has a negative reduced cost given potential u,
+    // ignoring columns with no capacity
+    [[nodiscard]] bool feasible(std::size_t i, T u) const {
+        for (std::size_t e = m_c.row_start[i]; e < m_c.row_start[i + 1]; e++) {
+            if (capacity(m_c.col[e]) > 0 && m_c.cost[e] - m_v[m_c.col[e]] < u) {
+                return false;
+            }
+        }
+        return m_c.kick[i] >= u;
+    }
+
+    // Offer the edges of row r, reached at reduced distance base
+    void relax(std::uint32_t r, T base) {
+        for (std::size_t e = m_c.row_start[r]; e < m_c.row_start[r + 1]; e++) {
+            offer(m_c.col[e], r, m_c.cost[e], base + m_c.cost[e] - m_v[m_c.col[e]]);
+        }
+        offer(m_c.cols, r, m_c.kick[r], base + m_c.kick[r]);
+    }
+
+    // Returns true if this improved the distance to column j
+    bool offer(std::uint32_t j, std::uint32_t r, T c, T dist) {
+        if (!m_done[j] && dist < m_d[j]) {
+            if (m_d[j] == inf) {
+                m_touched.push_back(j);
+            }
+            m_d[j] = dist;
+            m_pred[j] = {r, c};
+            m_heap.emplace_back(dist, j);
+            std::push_heap(m_heap.begin(), m_heap.end(), std::greater<>{});
+            return true;
+        }
+        return false;
+    }
+};
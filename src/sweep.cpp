@@ -0,0 +1,134 @@
+// Copyright (C) 2020 Conor Williams
+
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include "sweep.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <optional>
+#include <ostream>
+#include <vector>
+
+#include "ballot.hpp"
+#include "cohort.hpp"
+#include "cost.hpp"
+#include "parallel.hpp"
+#include "solve.hpp"
+
+std::vector<CostParams> cost_grid(std::optional<std::vector<double>> const& bias_fist,
+                                  std::optional<std::vector<double>> const& kick_cost,
+                                  std::optional<std::vector<double>> const& p_weight,
+                                  std::optional<std::vector<double>> const& hostel_penalty) {
+    CostParams const def = CostParams::of();
+
+    std::vector<double> const b = bias_fist.value_or(std::vector{def.bias_fist});
+    std::vector<double> const k = kick_cost.value_or(std::vector{def.kick_cost});
+    std::vector<double> const p = p_weight.value_or(std::vector{def.p_weight});
+    std::vector<double> const h = hostel_penalty.value_or(std::vector{def.hostel_penalty});
+
+    std::vector<CostParams> grid;
+
+    for (double bias : b) {
+        for (double kick : k) {
+            for (double weight : p) {
+                for (double penalty : h) {
+                    grid.emplace_back(bias, def.big_num, kick, weight, penalty);
+                }
+            }
+        }
+    }
+
+    return grid;
+}
+
+std::vector<SweepRow> sweep(Cohort const& c,
+                            std::vector<std::size_t> const& trimmed,
+                            std::vector<CostParams> const& grid,
+                            Solver solver,
+                            std::size_t threads) {
+    std::size_t max_pref = 0;
+    std::size_t max_priority = 0;
+
+    for (std::size_t i = 0; i < c.num_people(); i++) {
+        max_pref = std::max(max_pref, c.n_pref[i]);
+        max_priority = std::max(max_priority, c.priority[i]);
+    }
+
+    for (std::size_t p : trimmed) {
+        max_priority = std::max(max_priority, p);
+    }
+
+    std::vector<std::optional<SweepRow>> rows(grid.size());
+
+    parallel_tasks(grid.size(), threads, [&](std::size_t k) {
+        Solution const sol = solve(c, CostTable{c, grid[k]}, {solver, 1});
+
+        SweepRow row{grid[k]};
+
+        row.by_choice.resize(max_pref, 0);
+        row.kicked_by_priority.resize(max_priority + 1, 0);
+
+        for (std::uint32_t i = 0; i < c.num_people(); i++) {
+            if (std::optional r = sol.allocation[i]) {
+                ++row.allocated;
+                row.hostels += c.hostel[*r];
+                ++row.by_choice[*c.choice_index(i, *r)];
+            } else {
+                ++row.kicked;
+                ++row.kicked_by_priority[c.priority[i]];
+            }
+        }
+
+        for (std::size_t p : trimmed) {
+            ++row.kicked;
+            ++row.kicked_by_priority[p];
+        }
+
+        rows[k] = std::move(row);
+    });
+
+    std::vector<SweepRow> out;
+
+    for (auto&& row : rows) {
+        out.push_back(std::move(*row));
+    }
+
+    return out;
+}
+
+void write_sweep(std::ostream& out, std::vector<SweepRow> const& rows) {
+    if (rows.empty()) {
+        return;
+    }
+
+    out << "bias_fist,kick_cost,p_weight,hostel_penalty,allocated,hostels,kicked";
+
+    for (std::size_t i = 0; i < rows[0].by_choice.size(); i++) {
+        out << ",choice_" << i + 1;
+    }
+
+    for (std::size_t p = 0; p < rows[0].kicked_by_priority.size(); p++) {
+        out << ",kicked_p" << p;
+    }
+
+    out << '\n';
+
+    for (auto&& row : rows) {
+        out << row.params.bias_fist << ',' << row.params.kick_cost << ',' << row.params.p_weight
+            << ',' << row.params.hostel_penalty << ',' << row.allocated << ',' << row.hostels << ','
+            << row.kicked;
+
+        for (std::size_t n : row.by_choice) {
+            out << ',' << n;
+        }
+
+        for (std::size_t n : row.kicked_by_priority) {
+            out << ',' << n;
+        }
+
+        out << '\n';
+    }
+}
@@ -0,0 +1,48 @@
+// Copyright (C) 2020 Conor Williams
+
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <cstddef>
+#include <optional>
+#include <ostream>
+#include <vector>
+
+#include "ballot.hpp"
+#include "cohort.hpp"
+#include "cost.hpp"
+
+// The statistics reported by analayse for one point of a sweep
+struct SweepRow {
+    CostParams params;
+
+    std::size_t allocated = 0;
+    std::size_t hostels = 0;
+    std::size_t kicked = 0;
+
+    std::vector<std::size_t> by_choice{};           // Choice index -> number allocated it
+    std::vector<std::size_t> kicked_by_priority{};  // Priority -> number kicked
+};
+
+// Cartesian product of the values of each constant, a missing list uses the default
+std::vector<CostParams> cost_grid(std::optional<std::vector<double>> const& bias_fist,
+                                  std::optional<std::vector<double>> const& kick_cost,
+                                  std::optional<std::vector<double>> const& p_weight,
+                                  std::optional<std::vector<double>> const& hostel_penalty);
+
+/*
+ *  Solve the cohort at every point of the grid, concurrently on up to "threads" threads (one solve
+ *  per thread). The cohort is shared by all points, only the cost table is rebuilt. The priorities
+ *  of people trimmed by max_rooms are counted as kicked. Rows are in the order of the grid.
+ */
+std::vector<SweepRow> sweep(Cohort const&,
+                            std::vector<std::size_t> const& trimmed,
+                            std::vector<CostParams> const& grid,
+                            Solver solver,
+                            std::size_t threads);
+
+// Csv with a header, one line per row
+void write_sweep(std::ostream&, std::vector<SweepRow> const&);
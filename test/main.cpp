@@ -0,0 +1,318 @@
+// Copyright (C) 2020 Conor Williams
+
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <optional>
+#include <random>
+#include <source_location>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "ballot.hpp"
+#include "certificate.hpp"
+#include "cohort.hpp"
+#include "cost.hpp"
+#include "ingest.hpp"
+#include "picosha2.h"
+#include "public.hpp"
+#include "solve.hpp"
+
+namespace {  // Like static
+
+std::size_t failures = 0;
+
+void check(bool ok,
+           std::string_view what,
+           std::source_location loc = std::source_location::current()) {
+    if (!ok) {
+        std::cout << loc.file_name() << ':' << loc.line() << ": failed: " << what << '\n';
+        ++failures;
+    }
+}
+
+// True if f() throws a std::runtime_error
+template <typename F> bool throws(F&& f) {
+    try {
+        f();
+    } catch (std::runtime_error const&) {
+        return true;
+    }
+    return false;
+}
+
+// Random people each with k distinct choices of m rooms, popular rooms are chosen more often
+std::vector<Person> random_people(std::mt19937& gen, std::size_t n, std::size_t m, std::size_t k) {
+    std::vector<Person> people;
+
+    for (std::size_t i = 0; i < n; i++) {
+        impl::Person p;
+
+        p.name = "P" + std::to_string(i);
+        p.priority = 1 + gen() % 4;
+
+        while (p.pref.size() < std::min(k, m)) {
+            std::string room = "R" + std::to_string(std::min(gen() % m, gen() % m));
+
+            if (!p.choice_index(room)) {
+                p.pref.push_back(std::move(room));
+            }
+        }
+
+        people.emplace_back(std::move(p));
+    }
+
+    return people;
+}
+
+// A random cohort, some rooms take two people and some are closed
+Cohort random_cohort(std::mt19937& gen, std::size_t n, std::size_t m, std::size_t k) {
+    std::vector people = random_people(gen, n, m, k);
+
+    std::map<std::string, std::size_t> capacities;
+
+    for (std::size_t r = 0; r < m; r += 7) {
+        capacities["R" + std::to_string(r)] = gen() % 3;
+    }
+
+    return intern(people, find_rooms(people), std::vector<std::string>{"R1"}, capacities);
+}
+
+double total_cost(Cohort const& c, CostTable const& t, Allocation const& a) {
+    double sum = 0;
+
+    for (std::uint32_t i = 0; i < a.size(); i++) {
+        sum += t(c, i, a[i]);
+    }
+
+    return sum;
+}
+
+void test_certificate() {
+    std::mt19937 gen{1};
+
+    // Without capacities every allocated room takes one person
+    std::vector people = random_people(gen, 60, 40, 4);
+
+    Cohort const c = intern(people, find_rooms(people), std::nullopt);
+    CostTable const t{c};
+
+    Solution const sol = solve(c, t, {Solver::lapjv});
+
+    check(!throws([&] { check_certificate(c, t, sol); }), "valid certificate passes");
+
+    // Find person b who chose the room person a was allocated
+    std::optional<std::uint32_t> a;
+    std::optional<std::uint32_t> b;
+
+    for (std::uint32_t i = 0; i < c.num_people() && !b; i++) {
+        for (std::uint32_t j = 0; j < c.num_people() && !b && sol.allocation[i]; j++) {
+            if (j != i && c.choice_index(j, *sol.allocation[i])) {
+                a = i;
+                b = j;
+            }
+        }
+    }
+
+    check(b.has_value(), "two people chose the same room");
+
+    Solution moved = sol;
+    moved.allocation[*b] = sol.allocation[*a];
+    check(throws([&] { check_certificate(c, t, moved); }), "two people in one room fails");
+
+    Solution unknown = sol;
+    unknown.allocation[*a] = static_cast<std::uint32_t>(c.num_rooms());
+    check(throws([&] { check_certificate(c, t, unknown); }), "unknown room fails");
+
+    Solution u = sol;
+    u.u[*a] += 1;
+    check(throws([&] { check_certificate(c, t, u); }), "tampered u fails");
+
+    Solution v = sol;
+    v.v[*sol.allocation[*a]] -= 1;
+    check(throws([&] { check_certificate(c, t, v); }), "tampered v fails");
+
+    Solution people_size = sol;
+    people_size.allocation.pop_back();
+    check(throws([&] { check_certificate(c, t, people_size); }), "wrong number of people fails");
+
+    Solution rooms_size = sol;
+    rooms_size.v.push_back(0);
+    check(throws([&] { check_certificate(c, t, rooms_size); }), "wrong number of rooms fails");
+}
+
+std::vector<unsigned char> read_bytes(std::filesystem::path const& path) {
+    std::ifstream file(path, std::ios::binary);
+    return {std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+}
+
+void write_bytes(std::filesystem::path const& path, std::vector<unsigned char> const& bytes) {
+    std::ofstream file(path, std::ios::binary);
+    file.write(reinterpret_cast<char const*>(bytes.data()), bytes.size());
+}
+
+// Replace the trailing SHA-256 of a binary ballot with that of its (edited) body
+void rehash(std::vector<unsigned char>& bytes) {
+    auto const body = bytes.end() - picosha2::k_digest_size;
+    picosha2::hash256(bytes.begin(), body, body, bytes.end());
+}
+
+void test_binary() {
+    std::mt19937 gen{2};
+
+    auto const dir = std::filesystem::temp_directory_path();
+    auto const fname = dir / "ballot_test.bin";
+
+    PublicBallot ballot;
+
+    ballot.max_rooms = 20;
+    ballot.hostels = std::vector<std::string>{"R1", "R2"};
+    ballot.people = random_people(gen, 30, 25, 3);
+    ballot.solver = Solver::sparse;
+    ballot.integer = true;
+    ballot.capacities = {{"R0", 2}, {"R5", 0}};
+    ballot.solution.allocation = {3, std::nullopt, 7};
+    ballot.solution.u = {0.25, -1.5, 1e-300};
+    ballot.solution.v = {-0.125, 0};
+
+    for (auto&& p : ballot.people) {
+        p->secret_name = "secret " + p->name;
+    }
+
+    save_public(fname.string(), ballot, Format::binary);
+
+    PublicBallot const loaded = load_public(fname.string());
+
+    bool same_people = loaded.people.size() == ballot.people.size();
+
+    for (std::size_t i = 0; same_people && i < ballot.people.size(); i++) {
+        same_people = loaded.people[i]->priority == ballot.people[i]->priority
+                      && loaded.people[i]->pref == ballot.people[i]->pref
+                      && loaded.people[i]->secret_name == ballot.people[i]->secret_name;
+    }
+
+    check(same_people, "binary round-trips the people");
+    check(loaded.max_rooms == ballot.max_rooms, "binary round-trips max_rooms");
+    check(loaded.hostels == ballot.hostels, "binary round-trips the hostels");
+    check(loaded.solver == ballot.solver, "binary round-trips the solver");
+    check(loaded.integer && !loaded.components && !loaded.presolve, "binary round-trips flags");
+    check(loaded.capacities == ballot.capacities, "binary round-trips the capacities");
+    check(loaded.solution.allocation == ballot.solution.allocation, "binary round-trips alloc");
+    check(loaded.solution.u == ballot.solution.u, "binary round-trips u");
+    check(loaded.solution.v == ballot.solution.v, "binary round-trips v");
+
+    std::vector const bytes = read_bytes(fname);
+
+    std::vector flipped = bytes;
+    flipped[flipped.size() / 2] ^= 1;
+    write_bytes(fname, flipped);
+
+    check(throws([&] { load_public(fname.string()); }), "flipped byte fails the hash");
+
+    // The flags word is where a ballot differing only in its flags differs
+    ballot.integer = false;
+    ballot.presolve = true;
+
+    save_public(fname.string(), ballot, Format::binary);
+
+    std::vector other = read_bytes(fname);
+
+    auto const at = std::mismatch(bytes.begin(), bytes.end(), other.begin()).first - bytes.begin();
+
+    other[at + 3] = 0x80;
+    rehash(other);
+    write_bytes(fname, other);
+
+    check(throws([&] { load_public(fname.string()); }), "unknown flag bits are rejected");
+
+    std::filesystem::remove(fname);
+}
+
+PeopleCsv people_csv(std::string_view text) { return PeopleCsv{text.data(), text.size()}; }
+
+void test_people_csv() {
+    PeopleCsv const csv = people_csv(
+        "\"Smith, Jo\" , js1 ,2, \"R1, upstairs\" ,R2\r\n"
+        "\n"
+        "   \n"
+        "Ann,ab2,  10  ,\" R3 \",R4");
+
+    check(csv.size() == 2, "blank lines are skipped");
+    check(csv.choices() == 2, "number of choices");
+    check(csv.name(0) == "Smith, Jo", "quoted cell keeps its comma");
+    check(csv.crsid(0) == "js1", "cells are trimmed");
+    check(csv.priority(0) == 2 && csv.priority(1) == 10, "priorities");
+    check(csv.pref(0)[0] == "R1, upstairs", "quoted choice keeps its comma");
+    check(csv.pref(0)[1] == "R2", "carriage return is trimmed");
+    check(csv.pref(1)[0] == "R3", "quoted cell is trimmed");
+
+    check(throws([] { people_csv("A,a1,1,R1,\n"); }), "trailing comma is an empty choice");
+    check(throws([] { people_csv("A,a1,1,R1,,R2\n"); }), "empty choice in the middle");
+    check(throws([] { people_csv("A,a1,x,R1\n"); }), "invalid priority");
+    check(throws([] { people_csv("A,a1,1,R1\nB,b1,1,R1,R2\n"); }), "different numbers of choices");
+}
+
+void test_solvers() {
+    std::mt19937 gen{3};
+
+    for (int it = 0; it < 20; it++) {
+        std::size_t const n = 5 + gen() % 80;
+        std::size_t const m = n / 2 + gen() % n;
+
+        Cohort const c = random_cohort(gen, n, m, 1 + gen() % 5);
+
+        for (bool integer : {false, true}) {
+            CostTable const t = integer ? CostTable{c}.quantised() : CostTable{c};
+
+            double const best = total_cost(c, t, solve(c, t, {Solver::lapjv}).allocation);
+
+            for (SolveOptions const opt : {SolveOptions{Solver::sparse},
+                                           SolveOptions{Solver::auction, 2},
+                                           SolveOptions{Solver::lapjv, 1, false, true},
+                                           SolveOptions{Solver::sparse, 1, false, true}}) {
+                std::string const what = std::string{solver_name(opt.solver)}
+                                         + (opt.presolve ? " with presolve" : "")
+                                         + (integer ? ", integer costs" : "");
+
+                Solution const sol = solve(c, t, opt);
+
+                check(!throws([&] { check_certificate(c, t, sol); }), what + " is certified");
+
+                double const cost = total_cost(c, t, sol.allocation);
+
+                check(integer ? cost == best : std::abs(cost - best) <= 1e-9 * n,
+                      what + " costs as much as lapjv");
+            }
+        }
+    }
+}
+
+}  // namespace
+
+int main() {
+    test_certificate();
+    test_binary();
+    test_people_csv();
+    test_solvers();
+
+    if (failures > 0) {
+        std::cout << failures << " checks failed\n";
+        return 1;
+    }
+
+    std::cout << "All checks passed\n";
+    return 0;
+}